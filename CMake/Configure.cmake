@@ -62,6 +62,16 @@ try_compile(HAVE_CXX_MPI_INIT_THREAD ${PROJECT_BINARY_DIR}/config
   CMAKE_FLAGS "-DINCLUDE_DIRECTORIES:STRING=${MPI_CXX_INCLUDE_PATH}"
   LINK_LIBRARIES ${MPI_CXX_LIBRARIES})
 
+try_compile(HAVE_MPI_WIN_ALLOCATE_SHARED ${PROJECT_BINARY_DIR}/config
+  ${PROJECT_SOURCE_DIR}/CMake/config/mpi_win_allocate_shared.cpp
+  CMAKE_FLAGS "-DINCLUDE_DIRECTORIES:STRING=${MPI_CXX_INCLUDE_PATH}"
+  LINK_LIBRARIES ${MPI_CXX_LIBRARIES})
+
+try_compile(HAVE_MPI_WIN_CREATE_DYNAMIC ${PROJECT_BINARY_DIR}/config
+  ${PROJECT_SOURCE_DIR}/CMake/config/mpi_win_create_dynamic.cpp
+  CMAKE_FLAGS "-DINCLUDE_DIRECTORIES:STRING=${MPI_CXX_INCLUDE_PATH}"
+  LINK_LIBRARIES ${MPI_CXX_LIBRARIES})
+
 if(MPI_IMPLEMENTATION STREQUAL "BGL")
   set(MPI_CXX_COMPILE_FLAGS
     "${MPI_CXX_COMPILE_FLAGS} -qarch=440 -qtune=440 -qhot -qnostrict")
@@ -0,0 +1,12 @@
+#include <mpi.h>
+
+int main(int argc, char* argv[])
+{
+    MPI_Comm node;
+    MPI_Win win;
+    char* base;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0,
+                        MPI_INFO_NULL, &node);
+    MPI_Win_allocate_shared(0, 1, MPI_INFO_NULL, node, &base, &win);
+    MPI_Win_sync(win);
+}
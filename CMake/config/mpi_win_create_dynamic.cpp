@@ -0,0 +1,10 @@
+#include <mpi.h>
+
+int main(int argc, char* argv[])
+{
+    MPI_Win win;
+    char data;
+    MPI_Win_create_dynamic(MPI_INFO_NULL, MPI_COMM_WORLD, &win);
+    MPI_Win_attach(win, &data, 1);
+    MPI_Win_flush(0, win);
+}
@@ -138,6 +138,107 @@ getRank (int argc, char *argv[])
 }
 
 
+/*
+ * Predict the rank among the MPI processes on this node.  Used by the
+ * launcher to elect one process per node to parse the configuration
+ * file.
+ *
+ * return -1 on failure
+ */
+
+int
+getLocalRank ()
+{
+  const char* localRank = NULL;
+#ifdef OPENMPI
+  localRank = getenv ("OMPI_COMM_WORLD_LOCAL_RANK");
+#endif
+#ifdef MPICH2
+  localRank = getenv ("MPI_LOCALRANKID");
+#endif
+  if (localRank == NULL)
+    localRank = getenv ("SLURM_LOCALID");
+  if (localRank == NULL)
+    return -1;
+  int rank = atoi (localRank);
+  return rank < 0 ? -1 : rank;
+}
+
+
+/*
+ * Predict the number of MPI processes on this node.
+ *
+ * return -1 on failure
+ */
+
+int
+getLocalSize ()
+{
+  const char* localSize = NULL;
+#ifdef OPENMPI
+  localSize = getenv ("OMPI_COMM_WORLD_LOCAL_SIZE");
+#endif
+#ifdef MPICH2
+  localSize = getenv ("MPI_LOCALNRANKS");
+#endif
+  if (localSize != NULL)
+    {
+      int size = atoi (localSize);
+      return size < 1 ? -1 : size;
+    }
+
+  // SLURM_STEP_TASKS_PER_NODE has the form "2(x3),1": three nodes
+  // with two tasks followed by one node with one task
+  const char* tasksPerNode = getenv ("SLURM_STEP_TASKS_PER_NODE");
+  const char* nodeId = getenv ("SLURM_NODEID");
+  if (tasksPerNode == NULL || nodeId == NULL)
+    return -1;
+  int node = atoi (nodeId);
+  std::istringstream spec (tasksPerNode);
+  int tasks;
+  while (spec >> tasks)
+    {
+      int repeat = 1;
+      if (spec.peek () == '(')
+	{
+	  spec.ignore (2); // "(x"
+	  if (!(spec >> repeat))
+	    return -1;
+	  spec.ignore (); // ")"
+	}
+      if (node < repeat)
+	return tasks < 1 ? -1 : tasks;
+      node -= repeat;
+      if (spec.peek () == ',')
+	spec.ignore ();
+    }
+  return -1;
+}
+
+
+/*
+ * Return a string which identifies this MPI job and which is the
+ * same in all processes of the job.
+ *
+ * return "" on failure
+ */
+
+std::string
+getJobId ()
+{
+#ifdef OPENMPI
+  const char* jobId = getenv ("OMPI_MCA_ess_base_jobid");
+  if (jobId != NULL)
+    return jobId;
+#endif
+  const char* slurmJob = getenv ("SLURM_JOB_ID");
+  const char* slurmStep = getenv ("SLURM_STEP_ID");
+  if (slurmJob != NULL && slurmStep != NULL)
+    return std::string (slurmJob) + "." + slurmStep;
+  return "";
+}
+
+
 #ifdef MPICH
 std::string
 getSharedDir ()
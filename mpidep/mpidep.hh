@@ -19,8 +19,12 @@
 #ifndef MUSIC_MPIDEP_HH
 
 #include <iostream>
+#include <string>
 
 int getRank (int argc, char *argv[]);
+int getLocalRank ();
+int getLocalSize ();
+std::string getJobId ();
 std::istream* getConfig (int rank, int argc, char** argv);
 
 #define MUSIC_MPIDEP_HH
@@ -0,0 +1,119 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+//#define MUSIC_DEBUG 1
+#include "music/debug.hh" // Must be included first on BG/L
+
+#include "music/adaptive_buffering.hh"
+#include "music/temporal.hh"
+
+namespace MUSIC {
+
+  AdaptiveBuffering::AdaptiveBuffering ()
+    : nCommunications_ (0),
+      announce_ (false),
+      bytes_ (0),
+      nMessages_ (0),
+      blockedTime_ (0.0),
+      windowStart_ (0),
+      windowStartWtime_ (0.0)
+  {
+  }
+
+
+  void
+  AdaptiveBuffering::communicate (Synchronizer& synch, MPI::Intracomm comm)
+  {
+    int interval = synch.adaptiveInterval ();
+    announce_ = false;
+    if (nCommunications_ > 0 && nCommunications_ % interval == 0)
+      {
+	synch.adaptMaxBuffered (decide (synch, comm));
+	announce_ = true;
+      }
+    if (nCommunications_ % interval == 0)
+      {
+	windowStart_ = synch.localClock ().integerTime ();
+	windowStartWtime_ = MPI::Wtime ();
+	bytes_ = 0;
+	nMessages_ = 0;
+	blockedTime_ = 0.0;
+      }
+    ++nCommunications_;
+  }
+
+
+  /*
+   * Choose a new maxBuffered from the traffic of the last interval
+   * communications.  All sender processes use the largest mean
+   * message size so that they come to the same decision.
+   */
+
+  int
+  AdaptiveBuffering::decide (Synchronizer& synch, MPI::Intracomm comm)
+  {
+    long long local[3];
+    local[0] = nMessages_ > 0 ? bytes_ / nMessages_ : 0;
+    local[1] = static_cast<long long> (1e6 * blockedTime_);
+    local[2] = static_cast<long long> (1e6 * (MPI::Wtime ()
+					      - windowStartWtime_));
+    long long global[3];
+    comm.Allreduce (local, global, 3, MPI::LONG_LONG, MPI::MAX);
+    long long messageSize = global[0];
+    long long blocked = global[1];
+    long long elapsed = global[2];
+
+    Clock& localTime = synch.localClock ();
+    long long ticks = ((localTime.integerTime () - windowStart_)
+		       / localTime.tickInterval ());
+    if (ticks < 1)
+      ticks = 1;
+
+    long long current = synch.allowedBuffered ();
+    long long target;
+    if (messageSize == 0)
+      target = synch.bufferLimit ();
+    else
+      // Each message of the window carried ticks / interval ticks
+      // worth of data
+      target = (DEFAULT_PACKET_SIZE * ticks
+		/ (messageSize * synch.adaptiveInterval ()));
+
+    // Move gradually to avoid oscillation
+    if (target > 2 * current)
+      target = 2 * current > 0 ? 2 * current : 1;
+    else if (target < current / 2)
+      target = current / 2;
+
+    // If sending blocks for a large part of the time the receiver is
+    // lagging behind, and larger packets would only delay it
+    // further.  Short windows are dominated by timer resolution.
+    if (elapsed >= 1000 && 4 * blocked > elapsed && target > current)
+      target = current;
+
+    if (target > synch.bufferLimit ())
+      target = synch.bufferLimit ();
+    MUSIC_LOGR ("adaptive buffering: message size = " << messageSize
+		<< ", ticks = " << ticks
+		<< ", blocked = " << blocked << " of " << elapsed
+		<< " us, maxBuffered " << current << " -> " << target);
+    return target;
+  }
+
+}
@@ -27,6 +27,12 @@ namespace MUSIC {
   }
 
 
+  ApplicationMap::ApplicationMap (ConfigImageReader& in)
+  {
+    read (in);
+  }
+
+
   int
   ApplicationMap::nProcesses ()
   {
@@ -40,18 +46,17 @@ namespace MUSIC {
   ApplicationInfo*
   ApplicationMap::lookup (std::string appName)
   {
-    for (iterator i = begin (); i != end (); ++i)
-      {
-	if (i->name () == appName)
-	  return &*i;
-      }
-    return 0;
+    int id = names_.find (appName);
+    if (id == NameTable::NO_ID)
+      return 0;
+    return &(*this)[id];
   }
   
 
   void
   ApplicationMap::add (std::string name, int l, int n)
   {
+    names_.intern (name);
     push_back (ApplicationInfo (name, l, n));
   }
 
@@ -82,7 +87,34 @@ namespace MUSIC {
 	in.ignore ();
 	int np;
 	in >> np;
-	push_back (ApplicationInfo (name, leader, np));
+	add (name, leader, np);
+	leader += np;
+      }
+  }
+
+
+  void
+  ApplicationMap::write (ConfigImageWriter& out)
+  {
+    out.write (size ());
+    for (iterator i = begin (); i != end (); ++i)
+      {
+	out.write (i->name ());
+	out.write (i->nProc ());
+      }
+  }
+
+
+  void
+  ApplicationMap::read (ConfigImageReader& in)
+  {
+    int n = in.readInt ();
+    int leader = 0;
+    for (int i = 0; i < n; ++i)
+      {
+	std::string name = in.readString ();
+	int np = in.readInt ();
+	add (name, leader, np);
 	leader += np;
       }
   }
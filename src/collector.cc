@@ -136,8 +136,9 @@ namespace MUSIC {
 	    MUSIC_LOGX ("collect to dest = " << static_cast<void*> (dest)
 		       << ", begin = " << i->begin ()
 		       << ", length = " << i->length ());
+	    // The block holds the intervals of this buffer back to back
 	    memcpy (dest + i->begin (), src, i->length ());
-	    dest += i->length ();
+	    src += i->length ();
 	  }
       }
   }
@@ -0,0 +1,86 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "music/config_image.hh"
+#include "music/error.hh"
+
+namespace MUSIC {
+
+  void
+  ConfigImageWriter::write (int x)
+  {
+    image_.append (reinterpret_cast<char*> (&x), sizeof (x));
+  }
+
+
+  void
+  ConfigImageWriter::write (std::string s)
+  {
+    write (static_cast<int> (s.size ()));
+    image_.append (s);
+  }
+
+
+  void
+  ConfigImageReader::need (size_t n)
+  {
+    if (size_ - pos_ < n)
+      error ("truncated MUSIC configuration image");
+  }
+
+
+  int
+  ConfigImageReader::readInt ()
+  {
+    int x;
+    need (sizeof (x));
+    memcpy (&x, data_ + pos_, sizeof (x));
+    pos_ += sizeof (x);
+    return x;
+  }
+
+
+  std::string
+  ConfigImageReader::readString ()
+  {
+    int n = readInt ();
+    if (n < 0)
+      error ("corrupt MUSIC configuration image");
+    need (n);
+    std::string s (data_ + pos_, n);
+    pos_ += n;
+    return s;
+  }
+
+
+  // FNV-1a
+  unsigned long long
+  configImageHash (const char* data, size_t size)
+  {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i)
+      {
+	hash ^= static_cast<unsigned char> (data[i]);
+	hash *= 1099511628211ULL;
+      }
+    return hash;
+  }
+
+}
@@ -21,6 +21,16 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <cstdio>
+#include <fstream>
+
+extern "C" {
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+}
 
 #include "music/configuration.hh"
 #include "music/ioutils.hh"
@@ -77,7 +87,15 @@ namespace MUSIC {
    * NREMOTEPROCS = number of processes in the remote application
    *
    * CONFIGDICT = ...:VARNAMEk:VALUEk:...
+   *
+   *
+   * IMAGE:HASH:PATH means that the same information is stored in
+   * binary form in the configuration image PATH (see
+   * config_image.hh) written by the music launcher.  HASH is the
+   * hexadecimal hash of the image.
    */
+
+  static const char* const imageMagic = "MUSICCI1";
   
   Configuration::Configuration (std::string name, int color, Configuration* def)
     : applicationName_ (name), color_ (color), defaultConfig (def)
@@ -105,6 +123,11 @@ namespace MUSIC {
 	applications_ = new ApplicationMap ();
 	connectivityMap_ = new Connectivity ();
       }
+    else if (strncmp (configStr, "IMAGE:", 6) == 0)
+      {
+	launchedByMusic_ = true;
+	readImage (&configStr[6]); // after "IMAGE:"
+      }
     else
       {
 	launchedByMusic_ = true;
@@ -134,6 +157,49 @@ namespace MUSIC {
     delete applications_;
   }
 
+
+  void
+  Configuration::readImage (const char* spec)
+  {
+    char* path;
+    unsigned long long hash = strtoull (spec, &path, 16);
+    if (*path != ':')
+      error (std::string ("malformed configuration image reference: ")
+	     + spec);
+    ++path;
+
+    int fd = open (path, O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat (fd, &st) == -1)
+      error (std::string ("couldn't open configuration image ") + path);
+    size_t size = st.st_size;
+    void* image = mmap (0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (image == MAP_FAILED)
+      error (std::string ("couldn't map configuration image ") + path);
+    const char* data = static_cast<const char*> (image);
+    if (configImageHash (data, size) != hash)
+      error (std::string ("configuration image ") + path
+	     + " doesn't match the launcher");
+
+    imagePath_ = path;
+
+    ConfigImageReader in (data, size);
+    if (in.readString () != imageMagic)
+      error (std::string ("not a configuration image: ") + path);
+    applicationName_ = in.readString ();
+    color_ = in.readInt ();
+    applications_ = new ApplicationMap (in);
+    connectivityMap_ = new Connectivity (in);
+    int nVars = in.readInt ();
+    for (int i = 0; i < nVars; ++i)
+      {
+	std::string name = in.readString ();
+	insert (name, in.readString ());
+      }
+    munmap (image, size);
+  }
+
   
   void
   Configuration::write (std::ostringstream& env, Configuration* mask)
@@ -151,19 +217,112 @@ namespace MUSIC {
   }
 
   
+  void
+  Configuration::write (std::ostringstream& out)
+  {
+    out << applicationName_ << ':' << color_ << ':';
+    applications_->write (out);
+    out << ':';
+    connectivityMap_->write (out);
+    write (out, 0);
+  }
+
+  
   void
   Configuration::writeEnv ()
   {
     std::ostringstream env;
-    env << applicationName_ << ':' << color_ << ':';
-    applications_->write (env);
-    env << ':';
-    connectivityMap_->write (env);
-    write (env, 0);
+    write (env);
     defaultConfig->write (env, this);
     setenv (configEnvVarName, env.str ().c_str (), 1);
   }
 
+
+  void
+  Configuration::write (ConfigImageWriter& out, Configuration* mask)
+  {
+    std::map<std::string, std::string>::iterator pos;
+    for (pos = dict.begin (); pos != dict.end (); ++pos)
+      if (!(mask && mask->lookup (pos->first)))
+	{
+	  out.write (pos->first);
+	  out.write (pos->second);
+	}
+  }
+
+
+  /*
+   * Write the configuration as an image file in directory and refer
+   * to it in the environment.  The file name is derived from tag,
+   * which should identify the launch, and the hash of the image, so
+   * processes on the same node which launch the same application
+   * share one file which is written once.  The file is removed by
+   * removeImage when Setup is created.  Returns false if
+   * the image couldn't be written.
+   */
+
+  bool
+  Configuration::writeImageEnv (std::string directory, std::string tag)
+  {
+    ConfigImageWriter out;
+    out.write (std::string (imageMagic));
+    out.write (applicationName_);
+    out.write (color_);
+    applications_->write (out);
+    connectivityMap_->write (out);
+    // Local variables followed by those of the global section which
+    // are not overridden
+    int nVars = dict.size ();
+    std::map<std::string, std::string>::iterator pos;
+    for (pos = defaultConfig->dict.begin ();
+	 pos != defaultConfig->dict.end ();
+	 ++pos)
+      if (!lookup (pos->first))
+	++nVars;
+    out.write (nVars);
+    write (out, 0);
+    defaultConfig->write (out, this);
+
+    const std::string& image = out.image ();
+    unsigned long long hash = configImageHash (image.data (), image.size ());
+    char hashStr[17];
+    sprintf (hashStr, "%016llx", hash);
+    std::string path = directory + "/music-" + tag + "-" + hashStr + ".img";
+
+    struct stat st;
+    if (stat (path.c_str (), &st) != 0
+	|| static_cast<size_t> (st.st_size) != image.size ())
+      {
+	// Write to a private file first so that other processes never
+	// see a partial image
+	std::ostringstream tmpPath;
+	tmpPath << path << '.' << getpid ();
+	std::ofstream file (tmpPath.str ().c_str (), std::ios::binary);
+	file.write (image.data (), image.size ());
+	file.close ();
+	if (!file || rename (tmpPath.str ().c_str (), path.c_str ()) != 0)
+	  {
+	    std::remove (tmpPath.str ().c_str ());
+	    return false;
+	  }
+      }
+
+    std::string env = std::string ("IMAGE:") + hashStr + ":" + path;
+    setenv (configEnvVarName, env.c_str (), 1);
+    return true;
+  }
+
+
+  void
+  Configuration::removeImage ()
+  {
+    if (imagePath_.empty ())
+      return;
+    // Other processes sharing the image may have removed it already
+    unlink (imagePath_.c_str ());
+    imagePath_.clear ();
+  }
+
   
   bool
   Configuration::lookup (std::string name)
@@ -44,6 +44,12 @@ namespace MUSIC {
   {
     read (in);
   }
+
+
+  Connectivity::Connectivity (ConfigImageReader& in)
+  {
+    read (in);
+  }
   
 
   void
@@ -56,22 +62,19 @@ namespace MUSIC {
 		     int remoteLeader,
 		     int remoteNProc)
   {
-    std::map<std::string, int>::iterator cmapInfo
-      = connectivityMap.find (localPort);
+    int portId = portNames_.intern (localPort);
     ConnectivityInfo* info;
-    if (cmapInfo == connectivityMap.end ())
+    if (portId == static_cast<int> (connections_.size ()))
       {
 	MUSIC_LOG ("creating new entry for " << localPort);
-	int index = connections_.size ();
 	connections_.push_back (ConnectivityInfo (localPort, dir, width));
 	info = &connections_.back ();
 	MUSIC_LOG ("ci = " << info);
-	connectivityMap.insert (std::make_pair (localPort, index));
       }
     else
       {
 	MUSIC_LOG ("found old entry for " << localPort);
-	info = &connections_[cmapInfo->second];
+	info = &connections_[portId];
 	if (info->direction () != dir)
 	  error ("port " + localPort + " used both as output and input");
       }
@@ -86,54 +89,50 @@ namespace MUSIC {
   ConnectivityInfo*
   Connectivity::info (std::string portName)
   {
-    std::map<std::string, int>::iterator info
-      = connectivityMap.find (portName);
-    if (info == connectivityMap.end ())
+    int portId = portNames_.find (portName);
+    if (portId == NameTable::NO_ID)
       return (ConnectivityInfo*)NO_CONNECTIVITY;
     else
-      return &connections_[info->second];
+      return &connections_[portId];
   }
 
 
   bool
   Connectivity::isConnected (std::string portName)
   {
-    return connectivityMap.find (portName) != connectivityMap.end ();
+    return portNames_.find (portName) != NameTable::NO_ID;
   }
 
 
   ConnectivityInfo::PortDirection
   Connectivity::direction (std::string portName)
   {
-    return connections_[connectivityMap[portName]].direction ();
+    return connections_[portNames_.find (portName)].direction ();
   }
 
   
   int
   Connectivity::width (std::string portName)
   {
-    return connections_[connectivityMap[portName]].width ();
+    return connections_[portNames_.find (portName)].width ();
   }
 
   
   PortConnectorInfo
   Connectivity::connections (std::string portName)
   {
-    return connections_[connectivityMap[portName]].connections ();
+    return connections_[portNames_.find (portName)].connections ();
   }
 
 
   void
   Connectivity::write (std::ostringstream& out)
   {
-    out << connectivityMap.size ();
-    std::map<std::string, int>::iterator i;
-    for (i = connectivityMap.begin ();
-	 i != connectivityMap.end ();
-	 ++i)
+    out << connections_.size ();
+    std::vector<ConnectivityInfo>::iterator ci;
+    for (ci = connections_.begin (); ci != connections_.end (); ++ci)
       {
-	out << ':' << i->first << ':';
-	ConnectivityInfo* ci = &connections_[i->second];
+	out << ':' << ci->portName () << ':';
 	out << (unsigned int)ci->direction () << ':' << ci->width () << ':';
 	PortConnectorInfo conns = ci->connections ();
 	out << conns.size ();
@@ -204,5 +203,61 @@ namespace MUSIC {
 	  }
       }
   }
+
+
+  void
+  Connectivity::write (ConfigImageWriter& out)
+  {
+    out.write (connections_.size ());
+    std::vector<ConnectivityInfo>::iterator ci;
+    for (ci = connections_.begin (); ci != connections_.end (); ++ci)
+      {
+	out.write (ci->portName ());
+	out.write (ci->direction ());
+	out.write (ci->width ());
+	PortConnectorInfo conns = ci->connections ();
+	out.write (conns.size ());
+	PortConnectorInfo::iterator c;
+	for (c = conns.begin (); c != conns.end (); ++c)
+	  {
+	    out.write (c->receiverAppName ());
+	    out.write (c->receiverPortName ());
+	    out.write (c->receiverPortCode ());
+	    out.write (c->remoteLeader ());
+	    out.write (c->nProcesses ());
+	  }
+      }
+  }
+
+
+  void
+  Connectivity::read (ConfigImageReader& in)
+  {
+    int nPorts = in.readInt ();
+    for (int i = 0; i < nPorts; ++i)
+      {
+	std::string portName = in.readString ();
+	ConnectivityInfo::PortDirection pdir
+	  = static_cast<ConnectivityInfo::PortDirection> (in.readInt ());
+	int width = in.readInt ();
+	int nConnections = in.readInt ();
+	for (int i = 0; i < nConnections; ++i)
+	  {
+	    std::string recApp = in.readString ();
+	    std::string recPort = in.readString ();
+	    int recPortCode = in.readInt ();
+	    int rLeader = in.readInt ();
+	    int nProc = in.readInt ();
+	    add (portName,
+		 pdir,
+		 width,
+		 recApp,
+		 recPort,
+		 recPortCode,
+		 rLeader,
+		 nProc);
+	  }
+      }
+  }
   
 }
@@ -34,7 +34,12 @@ namespace MUSIC {
 			MPI::Intracomm c)
     : info (info_),
       spatialNegotiator_ (spatialNegotiator),
-      comm (c)
+      comm (c),
+      localTransport_ (NULL),
+      transport_ (NULL),
+      rmaWindow_ (NULL),
+      routingCache_ (NULL),
+      replayRouting_ (false)
   {
   }
 
@@ -46,7 +51,12 @@ namespace MUSIC {
     : info (info_),
       spatialNegotiator_ (spatialNegotiator),
       comm (c),
-      intercomm (ic)
+      intercomm (ic),
+      localTransport_ (NULL),
+      transport_ (NULL),
+      rmaWindow_ (NULL),
+      routingCache_ (NULL),
+      replayRouting_ (false)
   {
   }
 
@@ -59,19 +69,29 @@ namespace MUSIC {
 
   
   void
-  Connector::createIntercomm ()
+  Connector::cacheRouting (NegotiationIntervals* routing, bool replay)
   {
-    intercomm = comm.Create_intercomm (0,
-				       MPI::COMM_WORLD,
-				       info.remoteLeader (),
-				       CREATE_INTERCOMM_MSG);
+    routingCache_ = routing;
+    replayRouting_ = replay;
   }
 
 
-  void
-  Connector::freeIntercomm ()
+  NegotiationIterator
+  Connector::negotiateRouting ()
   {
-    intercomm.Free ();
+    if (replayRouting_)
+      return NegotiationIterator (*routingCache_);
+
+    NegotiationIterator i = spatialNegotiator_->negotiate (localTransport_,
+							   transport_,
+							   info.nProcesses (),
+							   receiverPortCode (),
+							   this); // only for debugging
+    if (routingCache_ != NULL)
+      for (NegotiationIterator j = i; !j.end (); ++j)
+	routingCache_->push_back (SpatialNegotiationData (j->interval (),
+							  j->rank ()));
+    return i;
   }
 
 
@@ -79,15 +99,19 @@ namespace MUSIC {
   OutputConnector::spatialNegotiation
   (std::vector<OutputSubconnector*>& osubconn,
    std::vector<InputSubconnector*>&)
+  {
+    makeSubconnectors (negotiateRouting (), osubconn);
+  }
+
+
+  // One subconnector for each remote rank we route to
+  void
+  OutputConnector::makeSubconnectors
+  (NegotiationIterator routing,
+   std::vector<OutputSubconnector*>& osubconn)
   {
     std::map<int, OutputSubconnector*> subconnectors;
-    for (NegotiationIterator i
-	   = spatialNegotiator_->negotiate (comm,
-					    intercomm,
-					    info.nProcesses (),
-					    this); // only for debugging
-	 !i.end ();
-	 ++i)
+    for (NegotiationIterator i = routing; !i.end (); ++i)
       {
 	std::map<int, OutputSubconnector*>::iterator c
 	  = subconnectors.find (i->rank ());
@@ -118,21 +142,24 @@ namespace MUSIC {
 
 
 
-  // NOTE: code repetition (OutputConnector::spatialNegotiation)
   void
   InputConnector::spatialNegotiation
   (std::vector<OutputSubconnector*>&,
    std::vector<InputSubconnector*>& isubconn)
+  {
+    makeSubconnectors (negotiateRouting (), isubconn);
+  }
+
+
+  // NOTE: code repetition (OutputConnector::makeSubconnectors)
+  void
+  InputConnector::makeSubconnectors
+  (NegotiationIterator routing,
+   std::vector<InputSubconnector*>& isubconn)
   {
     std::map<int, InputSubconnector*> subconnectors;
-    int receiverRank = intercomm.Get_rank ();
-    for (NegotiationIterator i
-	   = spatialNegotiator_->negotiate (comm,
-					    intercomm,
-					    info.nProcesses (),
-					    this); // only for debugging
-	 !i.end ();
-	 ++i)
+    int receiverRank = transport_->rank ();
+    for (NegotiationIterator i = routing; !i.end (); ++i)
       {
 	std::map<int, InputSubconnector*>::iterator c
 	  = subconnectors.find (i->rank ());
@@ -176,9 +203,10 @@ namespace MUSIC {
       {
 	// exchange tickInterval with peer leader
 	sRemoteTickInterval = tickInterval.serialize ();
+	int tag = portTag (receiverPortCode (), TICKINTERVAL_MSG);
 	intercomm.Sendrecv_replace (&sRemoteTickInterval, 2, MPI::UNSIGNED_LONG,
-				    0, TICKINTERVAL_MSG,
-				    0, TICKINTERVAL_MSG);
+				    0, tag,
+				    0, tag);
       }
     // broadcast to peers
     comm.Bcast (&sRemoteTickInterval, 2, MPI::UNSIGNED_LONG, 0);
@@ -199,8 +227,16 @@ namespace MUSIC {
   OutputSubconnector*
   ContOutputConnector::makeOutputSubconnector (int remoteRank)
   {
+    if (rmaWindow_ != NULL)
+      return new ContRMAOutputSubconnector (synchronizer (),
+					    transport_,
+					    rmaWindow_,
+					    remoteLeader (),
+					    remoteRank,
+					    receiverPortCode (),
+					    type_);
     return new ContOutputSubconnector (synchronizer (),
-				       intercomm,
+				       transport_,
 				       remoteLeader (),
 				       remoteRank,
 				       receiverPortCode (),
@@ -258,7 +294,9 @@ namespace MUSIC {
     if (synch.sample ())
       {
 	// copy application data to send buffers
+	double start = MPI::Wtime ();
 	distributor_.distribute ();
+	stats_.distributeTime += MPI::Wtime () - start;
       }
 
     synch.tick ();
@@ -296,13 +334,21 @@ namespace MUSIC {
   {
     synch.tick ();
     if (synch.sample ())
-      // sampling before and after time of receiver tick
-      sampler_.sampleOnce ();
+      {
+	// sampling before and after time of receiver tick
+	double start = MPI::Wtime ();
+	sampler_.sampleOnce ();
+	stats_.sampleTime += MPI::Wtime () - start;
+      }
     if (synch.interpolate ())
       {
+	double start = MPI::Wtime ();
 	sampler_.interpolate (synch.interpolationCoefficient ());
+	double middle = MPI::Wtime ();
 	synch.remoteTick ();
 	distributor_.distribute ();
+	stats_.interpolateTime += middle - start;
+	stats_.distributeTime += MPI::Wtime () - middle;
       }
     if (synch.communicate ())
       requestCommunication = true;
@@ -325,8 +371,17 @@ namespace MUSIC {
   InputSubconnector*
   ContInputConnector::makeInputSubconnector (int remoteRank, int receiverRank)
   {
+    if (rmaWindow_ != NULL)
+      return new ContRMAInputSubconnector (synchronizer (),
+					   transport_,
+					   rmaWindow_,
+					   remoteLeader (),
+					   remoteRank,
+					   receiverRank,
+					   receiverPortCode (),
+					   type_);
     return new ContInputSubconnector (synchronizer (),
-				      intercomm,
+				      transport_,
 				      remoteLeader (),
 				      remoteRank,
 				      receiverRank,
@@ -399,7 +454,9 @@ namespace MUSIC {
   PlainContInputConnector::postCommunication ()
   {
     // collect data from input buffers and write to application
+    double start = MPI::Wtime ();
     collector_.collect ();
+    stats_.collectTime += MPI::Wtime () - start;
   }
 
 
@@ -434,6 +491,7 @@ namespace MUSIC {
   void
   InterpolatingContInputConnector::postCommunication ()
   {
+    double start = MPI::Wtime ();
     if (first_)
       {
 	collector_.collect (sampler_.insert ());
@@ -445,7 +503,10 @@ namespace MUSIC {
 	collector_.collect (sampler_.insert ());
 	synch.remoteTick ();
       }
+    double middle = MPI::Wtime ();
     sampler_.interpolateToApplication (synch.interpolationCoefficient ());
+    stats_.collectTime += middle - start;
+    stats_.interpolateTime += MPI::Wtime () - middle;
   }
 
 
@@ -460,10 +521,57 @@ namespace MUSIC {
 					      MPI::Intracomm comm,
 					      EventRoutingMap* routingMap)
     : Connector (connInfo, spatialNegotiator, comm),
-      routingMap_ (routingMap)
+      routingMap_ (routingMap),
+      aggregator_ (NULL)
   {
   }
 
+
+  EventOutputConnector::~EventOutputConnector ()
+  {
+    delete aggregator_;
+  }
+
+
+  // With aggregation, events are routed to the buffers of the
+  // aggregator and only node leaders have subconnectors
+  void
+  EventOutputConnector::spatialNegotiation
+  (std::vector<OutputSubconnector*>& osubconn,
+   std::vector<InputSubconnector*>& isubconn)
+  {
+    if (aggregationLimit_ <= 0)
+      {
+	OutputConnector::spatialNegotiation (osubconn, isubconn);
+	return;
+      }
+    NegotiationIterator routing = negotiateRouting ();
+    aggregator_ = new EventOutputAggregator (localTransport_,
+					     portTag (receiverPortCode (),
+						      AGGREGATION_MSG));
+    if (!aggregator_->setup (comm, transport_, routing,
+			     aggregationLimit_, true))
+      {
+	delete aggregator_;
+	aggregator_ = NULL;
+	makeSubconnectors (routing, osubconn);
+	return;
+      }
+    for (NegotiationIterator i = routing; !i.end (); ++i)
+      routingMap_->insert (i->interval (), aggregator_->buffer (i->rank ()));
+    const std::vector<int>& nodePeers = aggregator_->nodePeers ();
+    for (std::vector<int>::const_iterator n = nodePeers.begin ();
+	 n != nodePeers.end ();
+	 ++n)
+      osubconn.push_back (new AggregatedEventOutputSubconnector
+			  (&synch,
+			   transport_,
+			   aggregator_,
+			   remoteLeader (),
+			   *n,
+			   receiverPortCode ()));
+  }
+
   
   void
   EventOutputConnector::initialize ()
@@ -476,10 +584,11 @@ namespace MUSIC {
   EventOutputConnector::makeOutputSubconnector (int remoteRank)
   {
     return new EventOutputSubconnector (&synch,
-					intercomm,
+					transport_,
 					remoteLeader (),
 					remoteRank,
-					receiverPortCode ());
+					receiverPortCode (),
+					&adaptive_);
   }
 
 
@@ -497,7 +606,30 @@ namespace MUSIC {
     synch.tick ();
     // Only assign requestCommunication if true
     if (synch.communicate ())
-      requestCommunication = true;
+      {
+	requestCommunication = true;
+	bool adaptive = synch.adaptiveInterval () > 0;
+	if (adaptive)
+	  adaptive_.communicate (synch, comm);
+	if (aggregator_ != NULL)
+	  {
+	    double start = MPI::Wtime ();
+	    int size = aggregator_->gather (adaptive && adaptive_.announce (),
+					    synch.allowedBuffered ());
+	    if (adaptive)
+	      adaptive_.recordSend (size, MPI::Wtime () - start);
+	  }
+      }
+  }
+
+
+  // Events inserted since the last communication are sent when the
+  // subconnectors are flushed
+  void
+  EventOutputConnector::finalize ()
+  {
+    if (aggregator_ != NULL)
+      aggregator_->gather (false, 0);
   }
 
   
@@ -508,8 +640,56 @@ namespace MUSIC {
 					    MPI::Intracomm comm)
     : Connector (connInfo, spatialNegotiator, comm),
       handleEvent_ (handleEvent),
-      type_ (type)
+      type_ (type),
+      aggregator_ (NULL)
+  {
+  }
+
+
+  EventInputConnector::~EventInputConnector ()
   {
+    delete aggregator_;
+  }
+
+
+  void
+  EventInputConnector::spatialNegotiation
+  (std::vector<OutputSubconnector*>& osubconn,
+   std::vector<InputSubconnector*>& isubconn)
+  {
+    if (aggregationLimit_ <= 0)
+      {
+	InputConnector::spatialNegotiation (osubconn, isubconn);
+	return;
+      }
+    NegotiationIterator routing = negotiateRouting ();
+    aggregator_ = new EventInputAggregator (localTransport_,
+					    portTag (receiverPortCode (),
+						     AGGREGATION_MSG),
+					    &synch,
+					    handleEvent_,
+					    type_);
+    if (!aggregator_->setup (comm, transport_, routing,
+			     aggregationLimit_, false))
+      {
+	delete aggregator_;
+	aggregator_ = NULL;
+	makeSubconnectors (routing, isubconn);
+	return;
+      }
+    int receiverRank = transport_->rank ();
+    const std::vector<int>& nodePeers = aggregator_->nodePeers ();
+    for (std::vector<int>::const_iterator n = nodePeers.begin ();
+	 n != nodePeers.end ();
+	 ++n)
+      isubconn.push_back (new AggregatedEventInputSubconnector
+			  (&synch,
+			   transport_,
+			   aggregator_,
+			   remoteLeader (),
+			   *n,
+			   receiverRank,
+			   receiverPortCode ()));
   }
 
   
@@ -525,7 +705,7 @@ namespace MUSIC {
   {
     if (type_ == Index::GLOBAL)
       return new EventInputSubconnectorGlobal (&synch,
-					       intercomm,
+					       transport_,
 					       remoteLeader (),
 					       remoteRank,
 					       receiverRank,
@@ -533,7 +713,7 @@ namespace MUSIC {
 					       handleEvent_.global ());
     else
       return new EventInputSubconnectorLocal (&synch,
-					      intercomm,
+					      transport_,
 					      remoteLeader (),
 					      remoteRank,
 					      receiverRank,
@@ -551,6 +731,15 @@ namespace MUSIC {
       requestCommunication = true;
   }
 
+
+  // Aggregated events are scattered over the node and delivered
+  void
+  EventInputConnector::postCommunication ()
+  {
+    if (aggregator_ != NULL && synch.communicate ())
+      aggregator_->scatter ();
+  }
+
   /********************************************************************
    *
    * Message Connectors
@@ -581,7 +770,7 @@ namespace MUSIC {
   MessageOutputConnector::makeOutputSubconnector (int remoteRank)
   {
     return new MessageOutputSubconnector (&synch,
-					  intercomm,
+					  transport_,
 					  remoteLeader (),
 					  remoteRank,
 					  receiverPortCode (),
@@ -642,7 +831,7 @@ namespace MUSIC {
   MessageInputConnector::makeInputSubconnector (int remoteRank, int receiverRank)
   {
     return new MessageInputSubconnector (&synch,
-					 intercomm,
+					 transport_,
 					 remoteLeader (),
 					 remoteRank,
 					 receiverRank,
@@ -19,6 +19,7 @@
 #include <mpi.h>
 
 #include <music/error.hh>
+#include <music/log.hh>
 
 #include <iostream>
 #include <stdlib.h>
@@ -28,6 +29,7 @@ namespace MUSIC {
   void
   error ()
   {
+    Log::flush ();
     MPI::COMM_WORLD.Abort (1);
   }
 
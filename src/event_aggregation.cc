@@ -0,0 +1,377 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//#define MUSIC_DEBUG 1
+#include "music/debug.hh" // Must be included first on BG/L
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <string>
+
+#include "music/event_aggregation.hh"
+
+namespace MUSIC {
+
+  EventAggregator::EventAggregator (Transport* local, int tag)
+    : local_ (local),
+      tag_ (tag),
+      rank_ (0)
+  {
+  }
+
+
+  bool
+  EventAggregator::setup (MPI::Intracomm comm,
+			  Transport* remote,
+			  NegotiationIterator routing,
+			  int limit,
+			  bool output)
+  {
+    rank_ = comm.Get_rank ();
+    int size = comm.Get_size ();
+
+    // Processes on the same node have the same processor name
+    std::vector<char> names (size * MPI_MAX_PROCESSOR_NAME);
+    char name[MPI_MAX_PROCESSOR_NAME];
+    std::fill (name, name + MPI_MAX_PROCESSOR_NAME, 0);
+    int length;
+    MPI_Get_processor_name (name, &length);
+    comm.Allgather (name, MPI_MAX_PROCESSOR_NAME, MPI::CHAR,
+		    &names[0], MPI_MAX_PROCESSOR_NAME, MPI::CHAR);
+    std::map<std::string, int> nodes;
+    leaders_.resize (size);
+    for (int r = 0; r < size; ++r)
+      {
+	std::string node (&names[r * MPI_MAX_PROCESSOR_NAME]);
+	std::map<std::string, int>::iterator n = nodes.find (node);
+	if (n == nodes.end ())
+	  n = nodes.insert (std::make_pair (node, r)).first;
+	leaders_[r] = n->second;
+	if (n->second == rank_ && r != rank_)
+	  members_.push_back (r);
+      }
+
+    // Exchange the node structure with the remote application
+    int remoteSize = remote->remoteSize ();
+    remoteLeaders_.resize (remoteSize);
+    if (rank_ == 0)
+      {
+	if (output)
+	  {
+	    remote->send (&leaders_[0], size, MPI::INT, 0, tag_);
+	    remote->receive (&remoteLeaders_[0], remoteSize, MPI::INT, 0, tag_);
+	  }
+	else
+	  {
+	    remote->receive (&remoteLeaders_[0], remoteSize, MPI::INT, 0, tag_);
+	    remote->send (&leaders_[0], size, MPI::INT, 0, tag_);
+	  }
+      }
+    comm.Bcast (&remoteLeaders_[0], remoteSize, MPI::INT, 0);
+
+    // The remote nodes routed to by the processes of our node
+    std::set<int> peers;
+    std::set<int> peerNodes;
+    long long width = 0;
+    for (NegotiationIterator i = routing; !i.end (); ++i)
+      {
+	peers.insert (i->rank ());
+	peerNodes.insert (remoteLeaders_[i->rank ()]);
+	width += i->end () - i->begin ();
+      }
+    if (isLeader ())
+      {
+	for (std::vector<int>::iterator m = members_.begin ();
+	     m != members_.end ();
+	     ++m)
+	  {
+	    int n;
+	    local_->receive (&n, 1, MPI::INT, *m, tag_);
+	    std::vector<int> theirs (n);
+	    if (n > 0)
+	      local_->receive (&theirs[0], n, MPI::INT, *m, tag_);
+	    peerNodes.insert (theirs.begin (), theirs.end ());
+	  }
+	nodePeers_.assign (peerNodes.begin (), peerNodes.end ());
+      }
+    else
+      {
+	std::vector<int> ours (peerNodes.begin (), peerNodes.end ());
+	int n = ours.size ();
+	local_->send (&n, 1, MPI::INT, leaders_[rank_], tag_);
+	if (n > 0)
+	  local_->send (&ours[0], n, MPI::INT, leaders_[rank_], tag_);
+      }
+
+    // Both sides see the same process and node pairs, but only the
+    // output side needs to count them
+    int aggregate = 0;
+    if (output)
+      {
+	long long local[3] = { static_cast<long long> (peers.size ()),
+			       width,
+			       static_cast<long long> (nodePeers_.size ()) };
+	long long total[3];
+	comm.Allreduce (local, total, 3, MPI::LONG_LONG, MPI::SUM);
+	long long routes = total[0];
+	aggregate = (total[2] < routes
+		     && (total[1] * static_cast<long long> (sizeof (Event))
+			 <= static_cast<long long> (limit) * routes));
+	MUSIC_LOGR ("event aggregation: " << routes << " routes, "
+		    << total[2] << " node routes, width " << total[1]
+		    << " -> " << aggregate);
+	if (rank_ == 0)
+	  remote->send (&aggregate, 1, MPI::INT, 0, tag_);
+      }
+    else
+      {
+	if (rank_ == 0)
+	  remote->receive (&aggregate, 1, MPI::INT, 0, tag_);
+	comm.Bcast (&aggregate, 1, MPI::INT, 0);
+      }
+    return aggregate;
+  }
+
+
+  void
+  EventAggregator::append (std::vector<char>& packet,
+			   int rank,
+			   const void* data,
+			   int size)
+  {
+    Header header;
+    header.rank = rank;
+    header.size = size;
+    const char* h = reinterpret_cast<const char*> (&header);
+    packet.insert (packet.end (), h, h + sizeof (Header));
+    const char* d = static_cast<const char*> (data);
+    packet.insert (packet.end (), d, d + size);
+  }
+
+
+  // The events of the block at offset, which is advanced to the next
+  // block
+  const Event*
+  EventAggregator::block (const std::vector<char>& packet,
+			  std::size_t& offset,
+			  Header& header)
+  {
+    memcpy (&header, &packet[offset], sizeof (Header));
+    const Event* events
+      = reinterpret_cast<const Event*> (&packet[offset + sizeof (Header)]);
+    offset += sizeof (Header) + header.size;
+    return events;
+  }
+
+
+  int
+  EventAggregator::nEvents (const std::vector<char>& packet)
+  {
+    int n = 0;
+    std::size_t offset = 0;
+    Header header;
+    while (offset < packet.size ())
+      {
+	const Event* ev = block (packet, offset, header);
+	int nEvents = header.size / sizeof (Event);
+	// The buffering mark isn't an event
+	if (nEvents > 0 && ev[nEvents - 1].id == BUFFERING_MARK)
+	  --nEvents;
+	n += nEvents;
+      }
+    return n;
+  }
+
+
+  FIBO*
+  EventOutputAggregator::buffer (int remoteRank)
+  {
+    std::map<int, FIBO>::iterator b = buffers_.find (remoteRank);
+    if (b == buffers_.end ())
+      b = buffers_.insert (std::make_pair (remoteRank,
+					   FIBO (sizeof (Event)))).first;
+    return &b->second;
+  }
+
+
+  int
+  EventOutputAggregator::gather (bool announce, int allowedBuffered)
+  {
+    std::vector<char> packet;
+    for (std::map<int, FIBO>::iterator b = buffers_.begin ();
+	 b != buffers_.end ();
+	 ++b)
+      {
+	if (announce)
+	  {
+	    Event* e = static_cast<Event*> (b->second.insert ());
+	    e->id = BUFFERING_MARK;
+	    e->t = allowedBuffered;
+	  }
+	void* data;
+	int size;
+	b->second.nextBlock (data, size);
+	if (size > 0)
+	  append (packet, b->first, data, size);
+      }
+    int size = packet.size ();
+    if (!isLeader ())
+      {
+	local_->send (&size, 1, MPI::INT, leaders_[rank_], tag_);
+	if (size > 0)
+	  local_->send (&packet[0], size, MPI::BYTE, leaders_[rank_], tag_);
+	return size;
+      }
+
+    // The subconnectors clear the packets they send
+    sortByNode (packet);
+    std::vector<char> theirs;
+    for (std::vector<int>::iterator m = members_.begin ();
+	 m != members_.end ();
+	 ++m)
+      {
+	int n;
+	local_->receive (&n, 1, MPI::INT, *m, tag_);
+	theirs.resize (n);
+	if (n > 0)
+	  local_->receive (&theirs[0], n, MPI::BYTE, *m, tag_);
+	sortByNode (theirs);
+      }
+    return size;
+  }
+
+
+  void
+  EventOutputAggregator::sortByNode (const std::vector<char>& packet)
+  {
+    std::size_t offset = 0;
+    Header header;
+    while (offset < packet.size ())
+      {
+	const Event* events = block (packet, offset, header);
+	append (packets_[remoteLeaders_[header.rank]],
+		header.rank, events, header.size);
+      }
+  }
+
+
+  void
+  EventInputAggregator::sort (const std::vector<char>& packet)
+  {
+    std::size_t offset = 0;
+    Header header;
+    while (offset < packet.size ())
+      {
+	const Event* events = block (packet, offset, header);
+	append (packets_[header.rank], header.rank, events, header.size);
+      }
+  }
+
+
+  // The maxBuffered announced by the senders in the packets of this
+  // communication, or NO_ANNOUNCEMENT.  All sender processes decide
+  // on the same value, so any mark will do.
+  int
+  EventInputAggregator::announcement ()
+  {
+    for (std::map<int, std::vector<char> >::iterator p = packets_.begin ();
+	 p != packets_.end ();
+	 ++p)
+      {
+	std::size_t offset = 0;
+	Header header;
+	while (offset < p->second.size ())
+	  {
+	    const Event* ev = block (p->second, offset, header);
+	    int nEvents = header.size / sizeof (Event);
+	    if (nEvents > 0 && ev[nEvents - 1].id == BUFFERING_MARK)
+	      return static_cast<int> (ev[nEvents - 1].t);
+	  }
+      }
+    return NO_ANNOUNCEMENT;
+  }
+
+
+  // The leader passes an announced maxBuffered on to every process of
+  // the node, also to those without routed intervals, so that all of
+  // them keep the communication schedule of the senders
+  void
+  EventInputAggregator::scatter ()
+  {
+    if (!isLeader ())
+      {
+	int header[2];		// size, maxBuffered
+	local_->receive (header, 2, MPI::INT, leaders_[rank_], tag_);
+	std::vector<char> packet (header[0]);
+	if (header[0] > 0)
+	  local_->receive (&packet[0], header[0], MPI::BYTE,
+			   leaders_[rank_], tag_);
+	if (header[1] != NO_ANNOUNCEMENT)
+	  synch_->adaptMaxBuffered (header[1]);
+	deliver (packet);
+	return;
+      }
+
+    int maxBuffered = announcement ();
+    for (std::vector<int>::iterator m = members_.begin ();
+	 m != members_.end ();
+	 ++m)
+      {
+	std::vector<char>& packet = packets_[*m];
+	int header[2] = { static_cast<int> (packet.size ()), maxBuffered };
+	local_->send (header, 2, MPI::INT, *m, tag_);
+	if (header[0] > 0)
+	  local_->send (&packet[0], header[0], MPI::BYTE, *m, tag_);
+	packet.clear ();
+      }
+    if (maxBuffered != NO_ANNOUNCEMENT)
+      synch_->adaptMaxBuffered (maxBuffered);
+    deliver (packets_[rank_]);
+    packets_[rank_].clear ();
+  }
+
+
+  void
+  EventInputAggregator::deliver (const std::vector<char>& packet)
+  {
+    std::size_t offset = 0;
+    Header header;
+    while (offset < packet.size ())
+      {
+	const Event* ev = block (packet, offset, header);
+	int nEvents = header.size / sizeof (Event);
+	// The mark has been taken care of by scatter
+	if (nEvents > 0 && ev[nEvents - 1].id == BUFFERING_MARK)
+	  --nEvents;
+	if (type_ == Index::GLOBAL)
+	  {
+	    EventHandlerGlobalIndex* handleEvent = handleEvent_.global ();
+	    for (int i = 0; i < nEvents; ++i)
+	      (*handleEvent) (ev[i].t, ev[i].id);
+	  }
+	else
+	  {
+	    EventHandlerLocalIndex* handleEvent = handleEvent_.local ();
+	    for (int i = 0; i < nEvents; ++i)
+	      (*handleEvent) (ev[i].t, ev[i].id);
+	  }
+      }
+  }
+
+}
@@ -23,33 +23,46 @@ configure_file(music/music-config.hh.in
 set(MUSIC_SOURCES
   BIFO.cc
   FIBO.cc
+  adaptive_buffering.cc
   application_map.cc
   array_data.cc
   clock.cc
   collector.cc
+  config_image.cc
   configuration.cc
   connection.cc
   connectivity.cc
   connector.cc
   distributor.cc
   error.cc
+  event_aggregation.cc
   event_router.cc
   index_map.cc
   index_map_factory.cc
   ioutils.cc
   linear_index.cc
+  log.cc
+  loop_analysis.cc
+  name_table.cc
+  negotiation_cache.cc
   parse.cc
   permutation_index.cc
   port.cc
   predict_rank.cc
+  rma_window.cc
   runtime.cc
   sampler.cc
   setup.cc
+  shared_memory_transport.cc
   spatial.cc
+  statistics.cc
   subconnector.cc
   synchronizer.cc
   temporal.cc
+  trace.cc
+  transport.cc
   version.cc
+  watchdog.cc
   )
 
 set(MUSIC_C_SOURCES
@@ -61,11 +74,13 @@ set(MUSIC_C_SOURCES
 set(MUSIC_HEADERS
   music/BIFO.hh
   music/FIBO.hh
+  music/adaptive_buffering.hh
   music/application_map.hh
   music/array_data.hh
   music/clock.hh
   music/collector.hh
   music/communication.hh
+  music/config_image.hh
   music/configuration.hh
   music/connection.hh
   music/connectivity.hh
@@ -74,6 +89,7 @@ set(MUSIC_HEADERS
   music/debug.hh
   music/distributor.hh
   music/error.hh
+  music/event_aggregation.hh
   music/event_router.hh
   music/index_map.hh
   music/index_map_factory.hh
@@ -81,7 +97,11 @@ set(MUSIC_HEADERS
   music/interval_tree.hh
   music/ioutils.hh
   music/linear_index.hh
+  music/log.hh
+  music/loop_analysis.hh
   music/message.hh
+  music/name_table.hh
+  music/negotiation_cache.hh
   music/parse.hh
   music/permutation_index.hh
   music/port.hh
@@ -90,10 +110,14 @@ set(MUSIC_HEADERS
   music/sampler.hh
   music/setup.hh
   music/spatial.hh
+  music/statistics.hh
   music/subconnector.hh
   music/synchronizer.hh
   music/temporal.hh
+  music/trace.hh
+  music/transport.hh
   music/version.hh
+  music/watchdog.hh
   )
 
 set(MUSIC_C_PUBLIC_HEADERS
@@ -106,11 +130,13 @@ set(MUSIC_PUBLIC_HEADERS
   music.hh
   music/BIFO.hh
   music/FIBO.hh
+  music/adaptive_buffering.hh
   music/application_map.hh
   music/array_data.hh
   music/clock.hh
   music/collector.hh
   music/communication.hh
+  music/config_image.hh
   music/configuration.hh
   music/connectivity.hh
   music/connector.hh
@@ -118,26 +144,35 @@ set(MUSIC_PUBLIC_HEADERS
   music/cont_data.hh
   music/distributor.hh
   music/event.hh
+  music/event_aggregation.hh
   music/event_router.hh
   music/data_map.hh
   music/debug.hh
   music/error.hh
   music/linear_index.hh
+  music/log.hh
+  music/loop_analysis.hh
   music/index_map.hh
   music/index_map_factory.hh
   music/interval.hh
   music/interval_tree.hh
   music/ioutils.hh
   music/message.hh
+  music/name_table.hh
+  music/negotiation_cache.hh
   music/port.hh
   music/permutation_index.hh
   music/runtime.hh
   music/setup.hh
   music/sampler.hh
   music/spatial.hh
+  music/statistics.hh
   music/subconnector.hh
   music/synchronizer.hh
   music/temporal.hh
+  music/trace.hh
+  music/transport.hh
   music/version.hh
+  music/watchdog.hh
   )
 
@@ -0,0 +1,126 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <mpi.h>
+
+#include "music/log.hh"
+#include "music/error.hh"
+
+#include <cstdlib>
+#include <iomanip>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+}
+
+namespace MUSIC {
+
+  LogLevel Log::level_ = LOG_NONE;
+  bool Log::rankSelected_ = true;
+  int Log::rank_ = -1;
+  int Log::fd_ = 2;
+  std::ostringstream Log::record_;
+  std::string Log::buffer_;
+
+
+  static void
+  flushAtExit ()
+  {
+    Log::flush ();
+  }
+
+
+  void
+  Log::configure (LogLevel level, int selectedRank, std::string fileName)
+  {
+    rank_ = MPI::COMM_WORLD.Get_rank ();
+    rankSelected_ = selectedRank == -1 || selectedRank == rank_;
+    if (!fileName.empty ())
+      {
+	// All processes append to the same file.  Each flush writes
+	// whole records, so records of different processes don't mix.
+	fd_ = open (fileName.c_str (), O_CREAT | O_WRONLY | O_APPEND, 0644);
+	if (fd_ == -1)
+	  error ("couldn't open log file " + fileName);
+      }
+    level_ = level;
+    if (level_ > LOG_NONE)
+      {
+	buffer_.reserve (LOG_BUFFER_SIZE);
+	// Applications need not call finalize
+	atexit (flushAtExit);
+      }
+  }
+
+
+  LogLevel
+  Log::parseLevel (std::string name)
+  {
+    if (name == "none")
+      return LOG_NONE;
+    else if (name == "info")
+      return LOG_INFO;
+    else if (name == "debug")
+      return LOG_DEBUG;
+    else if (name == "trace")
+      return LOG_TRACE;
+    error ("log_level must be one of none, info, debug or trace");
+    return LOG_NONE;
+  }
+
+
+  std::ostream&
+  Log::begin ()
+  {
+    record_.str ("");
+    record_ << std::fixed << std::setprecision (6) << MPI::Wtime ()
+	    << ' ' << rank_ << ": ";
+    record_.unsetf (std::ios::floatfield);
+    record_ << std::setprecision (6);
+    return record_;
+  }
+
+
+  void
+  Log::end ()
+  {
+    record_ << '\n';
+    buffer_ += record_.str ();
+    if (buffer_.size () >= LOG_BUFFER_SIZE)
+      flush ();
+  }
+
+
+  void
+  Log::flush ()
+  {
+    const char* data = buffer_.data ();
+    size_t size = buffer_.size ();
+    while (size > 0)
+      {
+	ssize_t n = write (fd_, data, size);
+	if (n <= 0)
+	  break;
+	data += n;
+	size -= n;
+      }
+    buffer_.clear ();
+  }
+
+}
@@ -0,0 +1,276 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "music/loop_analysis.hh"
+
+#include <algorithm>
+
+namespace MUSIC {
+
+  LoopAnalysis::LoopAnalysis (int nNodes)
+    : tickInterval_ (nNodes, 0), shortLoopDelay_ (0)
+  {
+  }
+
+
+  int
+  LoopAnalysis::addEdge (int pre, int post, ClockState latency, int maxBuffered)
+  {
+    Edge e;
+    e.pre = pre;
+    e.post = post;
+    e.tickInterval = tickInterval_[pre];
+    e.weight = latency - e.tickInterval;
+    e.maxBuffered = maxBuffered;
+    e.buffered = 0;
+    e.fixed = false;
+    edges_.push_back (e);
+    return edges_.size () - 1;
+  }
+
+
+  /*
+   * Tarjan's algorithm, without recursion so that stack depth
+   * doesn't grow with the number of applications.  Returns the
+   * strongly connected component of each node.
+   */
+
+  std::vector<int>
+  LoopAnalysis::findComponents ()
+  {
+    int n = nNodes ();
+    std::vector<std::vector<int> > successors (n);
+    for (std::vector<Edge>::iterator e = edges_.begin ();
+	 e != edges_.end ();
+	 ++e)
+      successors[e->pre].push_back (e->post);
+
+    std::vector<int> component (n, -1);
+    std::vector<int> index (n, -1);
+    std::vector<int> lowLink (n, 0);
+    std::vector<bool> onStack (n, false);
+    std::vector<int> stack;
+    // Each frame holds a node and the position in its successor list
+    std::vector<std::pair<int, unsigned int> > frames;
+    int nextIndex = 0;
+    int nComponents = 0;
+
+    for (int root = 0; root < n; ++root)
+      {
+	if (index[root] != -1)
+	  continue;
+	frames.push_back (std::make_pair (root, 0U));
+	while (!frames.empty ())
+	  {
+	    int v = frames.back ().first;
+	    unsigned int& next = frames.back ().second;
+	    if (next == 0)
+	      {
+		index[v] = lowLink[v] = nextIndex++;
+		stack.push_back (v);
+		onStack[v] = true;
+	      }
+	    if (next < successors[v].size ())
+	      {
+		int w = successors[v][next++];
+		if (index[w] == -1)
+		  frames.push_back (std::make_pair (w, 0U));
+		else if (onStack[w])
+		  lowLink[v] = std::min (lowLink[v], index[w]);
+		continue;
+	      }
+	    if (lowLink[v] == index[v])
+	      {
+		int w;
+		do
+		  {
+		    w = stack.back ();
+		    stack.pop_back ();
+		    onStack[w] = false;
+		    component[w] = nComponents;
+		  }
+		while (w != v);
+		++nComponents;
+	      }
+	    frames.pop_back ();
+	    if (!frames.empty ())
+	      {
+		int u = frames.back ().first;
+		lowLink[u] = std::min (lowLink[u], lowLink[v]);
+	      }
+	  }
+      }
+    return component;
+  }
+
+
+  ClockState
+  LoopAnalysis::bufferedTime (Edge& e, ClockState level)
+  {
+    if (e.fixed)
+      return e.buffered;
+    return std::min (level, e.maxBufferedTime ());
+  }
+
+
+  /*
+   * Bellman-Ford from a virtual source connected to all nodes.  Edge
+   * weights are the headroom left when non-fixed edges buffer level
+   * time.  Returns true, and the edges of a negative loop, if some
+   * loop constraint is violated.
+   */
+
+  bool
+  LoopAnalysis::findNegativeLoop (ClockState level, std::vector<int>& loop)
+  {
+    int n = nNodes ();
+    std::vector<ClockState> distance (n, 0);
+    std::vector<int> predecessor (n, -1);
+    int relaxed = -1;
+    for (int i = 0; i < n; ++i)
+      {
+	relaxed = -1;
+	for (unsigned int e = 0; e < edges_.size (); ++e)
+	  {
+	    Edge& edge = edges_[e];
+	    ClockState d = (distance[edge.pre] + edge.weight
+			    - bufferedTime (edge, level));
+	    if (d < distance[edge.post])
+	      {
+		distance[edge.post] = d;
+		predecessor[edge.post] = e;
+		relaxed = edge.post;
+	      }
+	  }
+	if (relaxed == -1)
+	  return false;
+      }
+    if (relaxed == -1)
+      return false;
+
+    // Still relaxing after n rounds: walk back until we are
+    // certainly inside the loop
+    int v = relaxed;
+    for (int i = 0; i < n; ++i)
+      v = edges_[predecessor[v]].pre;
+    loop.clear ();
+    int u = v;
+    do
+      {
+	loop.push_back (predecessor[u]);
+	u = edges_[predecessor[u]].pre;
+      }
+    while (u != v);
+    std::reverse (loop.begin (), loop.end ());
+    return true;
+  }
+
+
+  bool
+  LoopAnalysis::solve ()
+  {
+    std::vector<int> component = findComponents ();
+    for (std::vector<Edge>::iterator e = edges_.begin ();
+	 e != edges_.end ();
+	 ++e)
+      if (component[e->pre] != component[e->post])
+	{
+	  // Not part of any loop
+	  e->fixed = true;
+	  e->buffered = e->maxBufferedTime ();
+	}
+
+    // If negative we will not be able to make it in time around the
+    // loop even without any extra buffering
+    std::vector<int> loop;
+    if (findNegativeLoop (0, loop))
+      {
+	shortLoop_.clear ();
+	shortLoopDelay_ = 0;
+	for (unsigned int i = 0; i < loop.size (); ++i)
+	  {
+	    shortLoop_.push_back (edges_[loop[i]].pre);
+	    shortLoopDelay_ += edges_[loop[i]].weight;
+	  }
+	return false;
+      }
+
+    ClockState level = 0;
+    while (true)
+      {
+	// Edges which can't be raised further are frozen at their
+	// upper bound
+	ClockState top = level;
+	for (std::vector<Edge>::iterator e = edges_.begin ();
+	     e != edges_.end ();
+	     ++e)
+	  if (!e->fixed)
+	    {
+	      if (e->maxBufferedTime () <= level)
+		{
+		  e->fixed = true;
+		  e->buffered = e->maxBufferedTime ();
+		}
+	      else
+		top = std::max (top, e->maxBufferedTime ());
+	    }
+	if (top == level)
+	  break;
+
+	if (!findNegativeLoop (top, loop))
+	  {
+	    level = top;
+	    continue;
+	  }
+
+	// Largest feasible level is in [level, top)
+	ClockState high = top;
+	while (high - level > 1)
+	  {
+	    ClockState middle = level + (high - level) / 2;
+	    if (findNegativeLoop (middle, loop))
+	      high = middle;
+	    else
+	      level = middle;
+	  }
+
+	// Freeze the edges of every loop which becomes tight
+	while (findNegativeLoop (level + 1, loop))
+	  for (unsigned int i = 0; i < loop.size (); ++i)
+	    {
+	      Edge& e = edges_[loop[i]];
+	      if (!e.fixed)
+		{
+		  e.buffered = bufferedTime (e, level);
+		  e.fixed = true;
+		}
+	    }
+      }
+    return true;
+  }
+
+
+  int
+  LoopAnalysis::allowedBuffer (int edge)
+  {
+    Edge& e = edges_[edge];
+    return std::min (static_cast<int> (e.buffered / e.tickInterval),
+		     e.maxBuffered);
+  }
+
+}
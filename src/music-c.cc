@@ -497,6 +497,22 @@ MUSIC_tick (MUSIC_Runtime *runtime)
 }
 
 
+void
+MUSIC_ticks (MUSIC_Runtime *runtime, int n)
+{
+  MUSIC::Runtime* cxxRuntime = (MUSIC::Runtime *) runtime;
+  cxxRuntime->ticks (n);
+}
+
+
+void
+MUSIC_tickUntil (MUSIC_Runtime *runtime, double t)
+{
+  MUSIC::Runtime* cxxRuntime = (MUSIC::Runtime *) runtime;
+  cxxRuntime->tickUntil (t);
+}
+
+
 double
 MUSIC_time (MUSIC_Runtime *runtime)
 {
@@ -194,6 +194,10 @@ MUSIC_Runtime *MUSIC_createRuntime (MUSIC_Setup *setup, double h);
 
 void MUSIC_tick (MUSIC_Runtime *runtime);
 
+void MUSIC_ticks (MUSIC_Runtime *runtime, int n);
+
+void MUSIC_tickUntil (MUSIC_Runtime *runtime, double t);
+
 double MUSIC_time (MUSIC_Runtime *runtime);
 
 /* Finalization */
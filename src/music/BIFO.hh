@@ -57,6 +57,11 @@ namespace MUSIC {
     // size in bytes
     void trimBlock (int size);
     void* next ();
+    // Room guaranteed at the block returned by insertBlock ()
+    int maxBlockSize () { return maxBlockSize_; }
+    // The memory holding all blocks, which moves when it grows
+    void* storage () { return &buffer[0]; }
+    int capacity () { return size; }
   };
   
   
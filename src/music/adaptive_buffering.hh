@@ -0,0 +1,66 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MUSIC_ADAPTIVE_BUFFERING_HH
+
+#include <mpi.h>
+
+#include <music/synchronizer.hh>
+
+namespace MUSIC {
+
+  // In adaptive buffering mode, the sender side of an event
+  // connection measures the traffic it actually sends and, every
+  // Synchronizer::adaptiveInterval () communications, renegotiates
+  // how many ticks are buffered per packet.  The new value is chosen so that packets approach
+  // DEFAULT_PACKET_SIZE and never exceeds the loop safe limit found
+  // by the TemporalNegotiator.  It is agreed upon by all sender
+  // processes and appended as a mark to the packets of the
+  // communication where it was decided.  Both peers apply it before
+  // the next update of the communication schedule so that the
+  // mirrored nextSend and nextReceive clocks stay consistent.
+
+  class AdaptiveBuffering {
+    int nCommunications_;
+    bool announce_;
+    long long bytes_;
+    long long nMessages_;
+    double blockedTime_;	// time spent in MPI_Send
+    ClockState windowStart_;
+    double windowStartWtime_;
+    int decide (Synchronizer& synch, MPI::Intracomm comm);
+  public:
+    AdaptiveBuffering ();
+    // True if the packets of this communication carry a new value
+    bool announce () { return announce_; }
+    void recordSend (int bytes, double blockedTime)
+    {
+      bytes_ += bytes;
+      ++nMessages_;
+      blockedTime_ += blockedTime;
+    }
+    // Called by the connector at each communication, before the
+    // subconnectors send.  Collective over comm.
+    void communicate (Synchronizer& synch, MPI::Intracomm comm);
+  };
+
+}
+
+#define MUSIC_ADAPTIVE_BUFFERING_HH
+#endif
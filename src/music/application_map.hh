@@ -21,6 +21,9 @@
 #include <sstream>
 #include <vector>
 
+#include "music/config_image.hh"
+#include "music/name_table.hh"
+
 namespace MUSIC {
 
   class ApplicationInfo {
@@ -36,15 +39,21 @@ namespace MUSIC {
   };
 
   
+  // Applications must be added through add so that they can be
+  // looked up by name
   class ApplicationMap : public std::vector<ApplicationInfo> {
+    NameTable names_;
     void read (std::istringstream& in);
+    void read (ConfigImageReader& in);
   public:
     ApplicationMap () { }
     ApplicationMap (std::istringstream& in);
+    ApplicationMap (ConfigImageReader& in);
     ApplicationInfo* lookup (std::string appName);
     int nProcesses ();
     void add (std::string name, int l, int n);
     void write (std::ostringstream& out);
+    void write (ConfigImageWriter& out);
   };
 
 }
@@ -32,9 +32,19 @@ namespace MUSIC {
     CONT_MSG,
     SPIKE_MSG,
     MESSAGE_MSG,
-    FLUSH_MSG
+    AGGREGATION_MSG,
+    N_MESSAGE_TAGS
   };
 
+  // All ports connecting a pair of applications share one
+  // intercommunicator.  Traffic of different ports is separated by
+  // combining the tag with the receiver port code.
+  inline int
+  portTag (int receiverPortCode, MessageTag tag)
+  {
+    return receiverPortCode * N_MESSAGE_TAGS + tag;
+  }
+
 }
 
 #define MUSIC_COMMUNICATION_HH
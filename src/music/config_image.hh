@@ -0,0 +1,62 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUSIC_CONFIG_IMAGE_HH
+
+#include <string>
+
+namespace MUSIC {
+
+  // A configuration image is the binary counterpart of the
+  // _MUSIC_CONFIG_ string.  It is written by the music launcher to a
+  // node-local file and memory mapped by the application.  Integers
+  // are stored in native byte order, since the image never leaves
+  // the node, and strings are stored as a length followed by the
+  // characters.
+
+  class ConfigImageWriter {
+    std::string image_;
+  public:
+    void write (int x);
+    void write (std::string s);
+    const std::string& image () { return image_; }
+  };
+
+
+  class ConfigImageReader {
+    const char* data_;
+    size_t size_;
+    size_t pos_;
+    void need (size_t n);
+  public:
+    ConfigImageReader (const char* data, size_t size)
+      : data_ (data), size_ (size), pos_ (0) { }
+    int readInt ();
+    std::string readString ();
+    bool atEnd () { return pos_ == size_; }
+  };
+
+
+  // Hash used to check that a mapped image is the one the launcher
+  // wrote
+  unsigned long long configImageHash (const char* data, size_t size);
+
+}
+
+#define MUSIC_CONFIG_IMAGE_HH
+#endif
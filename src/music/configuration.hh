@@ -23,6 +23,7 @@
 
 #include "music/application_map.hh"
 #include "music/connectivity.hh"
+#include "music/config_image.hh"
 
 namespace MUSIC {
 
@@ -37,14 +38,24 @@ namespace MUSIC {
     ApplicationMap* applications_;
     Connectivity* connectivityMap_;
     std::map<std::string, std::string> dict;
+    std::string imagePath_;	// configuration image read, if any
     void write (std::ostringstream& env, Configuration* mask);
+    void write (ConfigImageWriter& out, Configuration* mask);
+    void readImage (const char* spec);
   public:
     Configuration ();
     Configuration (std::string name, int color, Configuration* def);
     ~Configuration ();
     bool launchedByMusic () { return launchedByMusic_; }
     bool postponeSetup () { return postponeSetup_; }
+    std::string name () { return applicationName_; }
+    void write (std::ostringstream& out);
     void writeEnv ();
+    bool writeImageEnv (std::string directory, std::string tag);
+    // Remove the configuration image this configuration was read
+    // from.  Only safe when every process which shares the image
+    // has read its configuration.
+    void removeImage ();
     int color () { return color_; };
     bool lookup (std::string name);
     bool lookup (std::string name, std::string* result);
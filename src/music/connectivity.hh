@@ -20,7 +20,9 @@
 
 #include <sstream>
 #include <vector>
-#include <map>
+
+#include "music/config_image.hh"
+#include "music/name_table.hh"
 
 namespace MUSIC {
 
@@ -79,13 +81,17 @@ namespace MUSIC {
   };
 
   
+  // Connectivity of the ports of one application.  connections_ is
+  // indexed by the port ids of portNames_.
   class Connectivity {
     std::vector<ConnectivityInfo> connections_;
-    std::map<std::string, int> connectivityMap;
+    NameTable portNames_;
     void read (std::istringstream& in);
+    void read (ConfigImageReader& in);
   public:
     Connectivity () { }
     Connectivity (std::istringstream& in);
+    Connectivity (ConfigImageReader& in);
     static const int NO_CONNECTIVITY = 0;
     void add (std::string localPort,
 	      ConnectivityInfo::PortDirection dir,
@@ -101,6 +107,7 @@ namespace MUSIC {
     int width (std::string portName);
     PortConnectorInfo connections (std::string portName);
     void write (std::ostringstream& out);
+    void write (ConfigImageWriter& out);
   };
 
 }
@@ -34,6 +34,7 @@
 #include <music/event_router.hh>
 
 #include <music/subconnector.hh>
+#include <music/statistics.hh>
 
 namespace MUSIC {
 
@@ -49,9 +50,26 @@ namespace MUSIC {
     SpatialNegotiator* spatialNegotiator_;
     MPI::Intracomm comm;
     MPI::Intercomm intercomm;
+    // Spatial negotiation and subconnectors communicate through these
+    Transport* localTransport_;
+    Transport* transport_;
+    // Cont data is put directly into remote memory through this
+    // window, if not NULL
+    RMAWindow* rmaWindow_;
+    // Routing intervals are recorded in, or replayed from, this
+    // buffer when a NegotiationCache is in use
+    NegotiationIntervals* routingCache_;
+    bool replayRouting_;
+    ConnectorStatistics stats_;
+    NegotiationIterator negotiateRouting ();
     
   public:
-    Connector () { }
+    Connector ()
+      : localTransport_ (NULL),
+	transport_ (NULL),
+	rmaWindow_ (NULL),
+	routingCache_ (NULL),
+	replayRouting_ (false) { }
     Connector (ConnectorInfo info_,
 	       SpatialNegotiator* spatialNegotiator_,
 	       MPI::Intracomm c);
@@ -66,18 +84,39 @@ namespace MUSIC {
     std::string receiverPortName () const { return info.receiverPortName (); }
     int receiverPortCode () const { return info.receiverPortCode (); }
     int remoteLeader () const { return info.remoteLeader (); }
+    int remoteNProcesses () const { return info.nProcesses (); }
     
+    SpatialNegotiator* spatialNegotiator () { return spatialNegotiator_; }
     int maxLocalWidth () { return spatialNegotiator_->maxLocalWidth (); }
+    void cacheRouting (NegotiationIntervals* routing, bool replay);
     bool isLeader ();
     virtual Synchronizer* synchronizer () = 0;
-    void createIntercomm ();
-    void freeIntercomm ();
+    // The intercommunicator is shared by all connectors between the
+    // same pair of applications and is owned by the Runtime
+    void setIntercomm (MPI::Intercomm ic) { intercomm = ic; }
+    // Transports are owned by the Runtime.  The local transport spans
+    // the processes of this application and the remote one is shared
+    // like the intercommunicator.
+    void setTransports (Transport* local, Transport* remote)
+    {
+      localTransport_ = local;
+      transport_ = remote;
+    }
+    // Also owned by the Runtime and shared between connectors
+    void setRMAWindow (RMAWindow* window) { rmaWindow_ = window; }
     virtual void
     spatialNegotiation (std::vector<OutputSubconnector*>& /* osubconn */,
 			std::vector<InputSubconnector*>& /* isubconn */) { }
     virtual void initialize () = 0;
     virtual void prepareForSimulation () { }
+    // Called before the subconnectors are flushed.  Collective over
+    // the processes of the application.
+    virtual void finalize () { }
     virtual void tick (bool& requestCommunication) = 0;
+    // True if tick () and postCommunication () have no effect except
+    // when the synchronizer is active
+    virtual bool idleBetweenCommunications () { return false; }
+    ConnectorStatistics& statistics () { return stats_; }
   };
 
   class PostCommunicationConnector : virtual public Connector {
@@ -91,6 +130,9 @@ namespace MUSIC {
 				     std::vector<InputSubconnector*>& isubconn);
     virtual void addRoutingInterval (IndexInterval i, OutputSubconnector* s);
     virtual OutputSubconnector* makeOutputSubconnector (int remoteRank) = 0;
+  protected:
+    void makeSubconnectors (NegotiationIterator routing,
+			    std::vector<OutputSubconnector*>& osubconn);
   };
   
   class InputConnector : virtual public Connector {
@@ -100,6 +142,9 @@ namespace MUSIC {
     virtual void addRoutingInterval (IndexInterval i, InputSubconnector* s);
     virtual InputSubconnector* makeInputSubconnector (int remoteRank,
 						      int receiverRank) = 0;
+  protected:
+    void makeSubconnectors (NegotiationIterator routing,
+			    std::vector<InputSubconnector*>& isubconn);
   };
 
   class ContConnector : virtual public Connector {
@@ -199,44 +244,67 @@ namespace MUSIC {
   };
 
   class EventConnector : virtual public Connector {
+  protected:
+    // Largest estimated message size, in bytes, of connections which
+    // are aggregated over nodes, or 0
+    int aggregationLimit_;
+  public:
+    EventConnector () : aggregationLimit_ (0) { }
+    bool idleBetweenCommunications () { return true; }
+    void setAggregationLimit (int limit) { aggregationLimit_ = limit; }
   };
   
   class EventOutputConnector : public OutputConnector, public EventConnector {
   private:
     OutputSynchronizer synch;
+    AdaptiveBuffering adaptive_;
     EventRoutingMap* routingMap_;
+    EventOutputAggregator* aggregator_;
     void send ();
   public:
     EventOutputConnector (ConnectorInfo connInfo,
 			  SpatialOutputNegotiator* spatialNegotiator,
 			  MPI::Intracomm comm,
 			  EventRoutingMap* routingMap);
+    ~EventOutputConnector ();
+    void spatialNegotiation (std::vector<OutputSubconnector*>& osubconn,
+			     std::vector<InputSubconnector*>& isubconn);
     OutputSubconnector* makeOutputSubconnector (int remoteRank);
     void addRoutingInterval (IndexInterval i, OutputSubconnector* osubconn);
     Synchronizer* synchronizer () { return &synch; }
     void initialize ();
     void tick (bool& requestCommunication);
+    void finalize ();
   };
   
-  class EventInputConnector : public InputConnector, public EventConnector {
+  class EventInputConnector : public InputConnector,
+			      public EventConnector,
+			      public PostCommunicationConnector {
     
   private:
     InputSynchronizer synch;
     EventHandlerPtr handleEvent_;
     Index::Type type_;
+    EventInputAggregator* aggregator_;
   public:
     EventInputConnector (ConnectorInfo connInfo,
 			 SpatialInputNegotiator* spatialNegotiator,
 			 EventHandlerPtr handleEvent,
 			 Index::Type type,
 			 MPI::Intracomm comm);
+    ~EventInputConnector ();
+    void spatialNegotiation (std::vector<OutputSubconnector*>& osubconn,
+			     std::vector<InputSubconnector*>& isubconn);
     InputSubconnector* makeInputSubconnector (int remoteRank, int receiverRank);
     Synchronizer* synchronizer () { return &synch; }
     void initialize ();
     void tick (bool& requestCommunication);
+    void postCommunication ();
   };
   
   class MessageConnector : virtual public Connector {
+  public:
+    bool idleBetweenCommunications () { return true; }
   };
   
   class MessageOutputConnector : public OutputConnector,
@@ -18,48 +18,49 @@
 
 #ifndef MUSIC_DEBUG_HH
 
-#ifdef MUSIC_DEBUG
-
 #include <mpi.h> // Must be included first on BG/L
-#include <iostream>
-// MUSIC_LOGLR:
-#include <sstream>
-#include <fstream>
-#include <iomanip>
-extern "C" {
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-#include <unistd.h>
-#include <sys/time.h>
-}
-
-#define MUSIC_LOG(X) (std::cerr << X << std::endl << std::flush)
 
+#include "music/log.hh"
+
+// Log statements are compiled into the library and enabled at run
+// time through the configuration variables log_level, log_rank and
+// log (see Log in log.hh).  The argument X is formatted with <<.
+
+#define MUSIC_LOGIF(C, L, X)						\
+  {									\
+    if (MUSIC::Log::enabled (L) && (C))					\
+      {									\
+	MUSIC::Log::begin () << X;					\
+	MUSIC::Log::end ();						\
+      }									\
+  }
+
+#define MUSIC_LOG(X) MUSIC_LOGIF (true, MUSIC::LOG_DEBUG, X)
+
+// Only on world rank N
 #define MUSIC_LOGN(N, X) \
-  { if (MPI::COMM_WORLD.Get_rank () == N) MUSIC_LOG (X); }
+  MUSIC_LOGIF (MUSIC::Log::rank () == (N), MUSIC::LOG_INFO, X)
 
 #define MUSIC_LOG0(X) MUSIC_LOGN (0, X)
 
-#define MUSIC_SLOGR(S, X)				\
-  {							\
-    (S) << MPI::COMM_WORLD.Get_rank () << ": "		\
-	<< X << std::endl << std::flush;		\
-  }
+#define MUSIC_LOGR(X) MUSIC_LOG (X)
 
-#define MUSIC_LOGR(X) MUSIC_SLOGR (std::cerr, X)
-
-#define MUSIC_LOGRE(X)					\
-  {							\
-    int _r = MPI::COMM_WORLD.Get_rank ();		\
-    char* _e = getenv ("MUSIC_DEBUG_RANK");		\
-    if (_e != NULL && atoi (_e) == _r)			\
-      {							\
-	std::cerr << _r << ": "				\
-		  << X << std::endl << std::flush;	\
-      }							\
-  }
+// Only on the rank selected by log_rank
+#define MUSIC_LOGRE(X) \
+  MUSIC_LOGIF (MUSIC::Log::rankSelected (), MUSIC::LOG_DEBUG, X)
+
+#define MUSIC_LOGX(X) MUSIC_LOGIF (true, MUSIC::LOG_TRACE, X)
+
+#define MUSIC_LOGLR(X) MUSIC_LOGX (X)
+
+#define MUSIC_TLOGR(X) MUSIC_LOGX (X)
 
+#ifdef MUSIC_DEBUG
+
+#include <iostream>
+
+// Collective over C, and therefore only compiled in when
+// MUSIC_DEBUG is defined
 #define MUSIC_LOGBR(C, X)			\
   {						\
     int _r = (C).Get_rank ();			\
@@ -68,59 +69,14 @@ extern "C" {
       {						\
 	(C).Barrier ();				\
 	if (_i == _r)				\
-	  MUSIC_LOGR (X);			\
+	  std::cerr << _r << ": " << X		\
+		    << std::endl << std::flush;	\
       }						\
   }
 
-namespace MUSIC {
-  static int debug_fd = 0;
-}
-
-#define MUSIC_LOGLR(X)							\
-  {									\
-    if (MUSIC::debug_fd == 0)						\
-      MUSIC::debug_fd = open ("/tmp/music_debug",			\
-			      O_CREAT | O_WRONLY | O_APPEND,		\
-			      00755);					\
-    lockf (MUSIC::debug_fd, F_LOCK, 0);					\
-    std::ostringstream ostr;						\
-    MUSIC_LOGR (X);                                                     \
-    MUSIC_SLOGR (ostr, X);						\
-    write (MUSIC::debug_fd, ostr.str ().c_str (), ostr.str ().length ()); \
-    lockf (MUSIC::debug_fd, F_ULOCK, 0);				\
-  }
-
-namespace MUSIC {
-  static std::ofstream logfile;
-}
-
-#define MUSIC_TLOGR(X)							\
-  {									\
-    if (!logfile.is_open ())						\
-      {									\
-	std::ostringstream name;					\
-	name << "/tmp/music_log" << MPI::COMM_WORLD.Get_rank ();	\
-	logfile.open (name.str ().c_str ());				\
-      }									\
-    struct timeval tv;							\
-    gettimeofday (&tv, NULL);						\
-    logfile << std::setw (10) << std::setfill ('0') << tv.tv_sec << std::setw (10) << std::setfill ('0') << tv.tv_usec << ' '; \
-    MUSIC_SLOGR (logfile, X);						\
-  }
-
-#define MUSIC_LOGX(X)
-
 #else
 
-#define MUSIC_LOG(X)
-#define MUSIC_LOGN(N, X)
-#define MUSIC_LOG0(X)
-#define MUSIC_LOGR(X)
-#define MUSIC_LOGRE(X)
 #define MUSIC_LOGBR(C, X)
-#define MUSIC_LOGLR(X)
-#define MUSIC_LOGX(X)
-#define MUSIC_TLOGR(X)
 
 #endif
 
@@ -0,0 +1,137 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUSIC_EVENT_AGGREGATION_HH
+
+#include <mpi.h>
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include <music/FIBO.hh>
+#include <music/event.hh>
+#include <music/index_map.hh>
+#include <music/spatial.hh>
+#include <music/synchronizer.hh>
+#include <music/transport.hh>
+
+namespace MUSIC {
+
+  // In an aggregated event connection, the processes on each node
+  // (those with the same processor name) are represented by a node
+  // leader, the process of lowest rank.  At each communication, the
+  // sender processes gather their events at their node leader, which
+  // sends one packet to each remote node leader it routes to.  The
+  // receiving node leader scatters the events to the processes of
+  // its node.  Only the leaders have subconnectors, which take part
+  // in the ordinary communication schedule, so the number of messages
+  // between the applications scales with the number of node pairs
+  // instead of the number of process pairs.  The gather is made when
+  // the output connector ticks and the scatter after the
+  // communication, and both only involve the processes of one node.
+  //
+  // A packet is a sequence of blocks, each a Header followed by the
+  // events of one sender process for the receiver process rank.
+
+  class EventAggregator {
+  public:
+    struct Header {
+      int rank;
+      int size;			// bytes of events
+    };
+    static const int FLUSH_MARK = -1;
+    // As in EventSubconnector
+    static const int BUFFERING_MARK = -2;
+    // Number of events in packet, not counting marks
+    static int nEvents (const std::vector<char>& packet);
+  protected:
+    Transport* local_;
+    int tag_;
+    int rank_;
+    std::vector<int> leaders_;	     // node leader of each local rank
+    std::vector<int> remoteLeaders_; // node leader of each remote rank
+    std::vector<int> members_;	     // the rest of our node if leader
+    std::vector<int> nodePeers_;     // remote node leaders we route to
+    static void append (std::vector<char>& packet, int rank,
+			const void* data, int size);
+    static const Event* block (const std::vector<char>& packet,
+			       std::size_t& offset,
+			       Header& header);
+  public:
+    EventAggregator (Transport* local, int tag);
+    virtual ~EventAggregator () { }
+    // Collective over comm and, through the process of rank 0, the
+    // remote application.  Returns true if the routing is better
+    // aggregated: if there are fewer node pairs than process pairs
+    // and, had each routed index one event per communication, the
+    // mean message would not exceed limit bytes.  The output side
+    // decides.
+    bool setup (MPI::Intracomm comm,
+		Transport* remote,
+		NegotiationIterator routing,
+		int limit,
+		bool output);
+    bool isLeader () { return leaders_[rank_] == rank_; }
+    const std::vector<int>& nodePeers () { return nodePeers_; }
+  };
+
+
+  class EventOutputAggregator : public EventAggregator {
+    std::map<int, FIBO> buffers_;		 // by remote rank
+    std::map<int, std::vector<char> > packets_; // by remote node leader
+    void sortByNode (const std::vector<char>& packet);
+  public:
+    EventOutputAggregator (Transport* local, int tag)
+      : EventAggregator (local, tag) { }
+    FIBO* buffer (int remoteRank);
+    // Moves the buffered events to the packets of the leader.
+    // Returns the number of bytes contributed by this process.
+    int gather (bool announce, int allowedBuffered);
+    std::vector<char>& packet (int nodePeer) { return packets_[nodePeer]; }
+  };
+
+
+  class EventInputAggregator : public EventAggregator {
+    Synchronizer* synch_;
+    EventHandlerPtr handleEvent_;
+    Index::Type type_;
+    std::map<int, std::vector<char> > packets_; // by local rank
+    static const int NO_ANNOUNCEMENT = -1;
+    int announcement ();
+    void deliver (const std::vector<char>& packet);
+  public:
+    EventInputAggregator (Transport* local,
+			  int tag,
+			  Synchronizer* synch,
+			  EventHandlerPtr handleEvent,
+			  Index::Type type)
+      : EventAggregator (local, tag),
+	synch_ (synch),
+	handleEvent_ (handleEvent),
+	type_ (type) { }
+    // Sorts a packet from a remote node leader by receiver
+    void sort (const std::vector<char>& packet);
+    // Distributes the sorted events over the node and delivers ours
+    void scatter ();
+  };
+
+}
+
+#define MUSIC_EVENT_AGGREGATION_HH
+#endif
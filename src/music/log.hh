@@ -0,0 +1,73 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUSIC_LOG_HH
+
+#include <sstream>
+#include <string>
+
+#define LOG_BUFFER_SIZE 65536
+
+namespace MUSIC {
+
+  enum LogLevel {
+    LOG_NONE,
+    LOG_INFO,			// once per run
+    LOG_DEBUG,			// once per communication
+    LOG_TRACE			// once per data element
+  };
+
+  // Leveled log used by the macros in debug.hh.  The level is
+  // resolved once, when the Setup reads the configuration, so that a
+  // disabled log statement costs a comparison.  Records are
+  // formatted into a buffer owned by the process and written with a
+  // single system call when the buffer is full, at finalize and
+  // before aborting on error.
+
+  class Log {
+  public:
+    static bool enabled (LogLevel level) { return level <= level_; }
+    static bool rankSelected () { return rankSelected_; }
+    static int rank () { return rank_; }
+
+    // selectedRank is the world rank for which MUSIC_LOGRE records
+    // are written, -1 for all ranks.  An empty fileName means
+    // standard error.
+    static void configure (LogLevel level,
+			   int selectedRank,
+			   std::string fileName);
+    static LogLevel parseLevel (std::string name);
+
+    // Start a record and return the stream to format it into
+    static std::ostream& begin ();
+    static void end ();
+    static void flush ();
+
+  private:
+    static LogLevel level_;
+    static bool rankSelected_;
+    static int rank_;
+    static int fd_;
+    static std::ostringstream record_;
+    static std::string buffer_;
+  };
+
+}
+
+#define MUSIC_LOG_HH
+#endif
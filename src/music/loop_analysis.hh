@@ -0,0 +1,88 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUSIC_LOOP_ANALYSIS_HH
+
+#include <vector>
+
+#include <music/clock.hh>
+
+namespace MUSIC {
+
+  // The LoopAnalysis computes how much buffering each connection of
+  // the application graph can be allowed without violating latency
+  // constraints.  Data sent around a loop of applications must arrive
+  // in time, so the sum over a loop of the buffered time of its edges
+  // may not exceed the sum of (latency - sender tick interval).
+  //
+  // Edges which are not part of any loop (i.e. which connect
+  // different strongly connected components) keep their upper bound.
+  // Within each strongly connected component, buffered time is
+  // distributed by progressive filling: all edges are raised
+  // together until some loop constraint becomes tight, the edges of
+  // that loop are frozen, and the remaining edges continue to be
+  // raised.  The result is the lexicographically max-min fair
+  // solution of the loop constraints, which, in particular, is never
+  // worse than distributing the headroom of each loop uniformly.
+  //
+  // The LoopAnalysis does not depend on MPI.
+
+  class LoopAnalysis {
+    class Edge {
+    public:
+      int pre;
+      int post;
+      ClockState weight;  // latency - tickInterval of pre
+      ClockState tickInterval;
+      int maxBuffered;
+      ClockState buffered;
+      bool fixed;
+      ClockState maxBufferedTime () { return maxBuffered * tickInterval; }
+    };
+    std::vector<ClockState> tickInterval_;
+    std::vector<Edge> edges_;
+    std::vector<int> shortLoop_;
+    ClockState shortLoopDelay_;
+    std::vector<int> findComponents ();
+    ClockState bufferedTime (Edge& e, ClockState level);
+    bool findNegativeLoop (ClockState level, std::vector<int>& loop);
+  public:
+    LoopAnalysis (int nNodes);
+    int nNodes () { return tickInterval_.size (); }
+    void setTickInterval (int node, ClockState ti)
+    {
+      tickInterval_[node] = ti;
+    }
+    // Returns index of the new edge.  maxBuffered is an upper bound
+    // in ticks of the sender.
+    int addEdge (int pre, int post, ClockState latency, int maxBuffered);
+    // Returns false if the latency around some loop is too short,
+    // even without buffering
+    bool solve ();
+    // Allowed buffering in ticks of the sender
+    int allowedBuffer (int edge);
+    // Nodes of a loop with too short latency, in order
+    std::vector<int>& shortLoop () { return shortLoop_; }
+    // Negative headroom of that loop
+    ClockState shortLoopDelay () { return shortLoopDelay_; }
+  };
+
+}
+
+#define MUSIC_LOOP_ANALYSIS_HH
+#endif
@@ -0,0 +1,53 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUSIC_NAME_TABLE_HH
+
+#include <string>
+#include <vector>
+
+namespace MUSIC {
+
+  // A NameTable interns strings, such as port names, and maps each
+  // distinct name to a dense integer id, in order of first insertion,
+  // so that tables indexed by name can be plain vectors.  Lookup is
+  // through an open addressing hash table and takes constant
+  // expected time.
+
+  class NameTable {
+    std::vector<std::string> names_;
+    std::vector<int> slots_;	// id of name in each slot or NO_ID
+    unsigned int mask_;
+    static unsigned int hash (const std::string& name);
+    unsigned int slot (const std::string& name) const;
+    void grow ();
+  public:
+    static const int NO_ID = -1;
+    NameTable ();
+    // Returns the id of name, adding it if it isn't in the table
+    int intern (const std::string& name);
+    // Returns NO_ID if name isn't in the table
+    int find (const std::string& name) const;
+    const std::string& name (int id) const { return names_[id]; }
+    int size () const { return names_.size (); }
+  };
+
+}
+
+#define MUSIC_NAME_TABLE_HH
+#endif
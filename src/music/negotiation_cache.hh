@@ -0,0 +1,82 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUSIC_NEGOTIATION_CACHE_HH
+
+#include <mpi.h>
+
+#include <string>
+#include <vector>
+
+#include <music/clock.hh>
+#include <music/spatial.hh>
+#include <music/connection.hh>
+
+namespace MUSIC {
+
+  class Setup;
+
+  // The NegotiationCache stores the outcome of spatial and temporal
+  // negotiation in a file per MPI process so that a later launch of
+  // an identical multi-simulation can skip negotiation.  It is
+  // enabled by giving the directory of the cache files in the
+  // configuration variable negotiation_cache.  Since validation is a
+  // collective operation over COMM_WORLD, the variable is one of
+  // the global variables checked by Runtime.
+  //
+  // The cache is keyed by a signature computed from the
+  // configuration, the application map, the tick interval, and the
+  // index map and connection parameters of every connector.  A saved
+  // cache is only used if the signature of every process matches and
+  // all processes saved their cache during the same launch, which is
+  // checked through a launch id chosen by rank 0 and stored in every
+  // file.
+
+  class NegotiationCache {
+    std::string fileName_;
+    unsigned long long signature_;
+    unsigned long long globalSignature_;
+    unsigned long long launch_;
+    bool valid_;
+    std::vector<NegotiationIntervals> routing_;
+    std::vector<char> temporal_;
+    void hash (const void* data, size_t size);
+    void hash (std::string s) { hash (s.data (), s.size ()); }
+    void hashIndexMap (IndexMap* indices, Index::Type type);
+    void hashConnection (Connection* connection);
+    bool read (unsigned long long& globalSignature,
+	       unsigned long long& launch);
+  public:
+    NegotiationCache (std::string directory,
+		      Setup* s,
+		      Clock& localTime,
+		      std::vector<Connection*>* connections);
+    bool validate ();
+    bool isValid () { return valid_; }
+    NegotiationIntervals* routing (int connector)
+    {
+      return &routing_[connector];
+    }
+    std::vector<char>& temporal () { return temporal_; }
+    void write ();
+  };
+
+}
+
+#define MUSIC_NEGOTIATION_CACHE_HH
+#endif
@@ -19,12 +19,17 @@
 #ifndef MUSIC_RUNTIME_HH
 
 #include <mpi.h>
+#include <map>
+#include <set>
+#include <string>
 #include <vector>
 
 #include "music/setup.hh"
 #include "music/port.hh"
 #include "music/clock.hh"
 #include "music/connector.hh"
+#include "music/negotiation_cache.hh"
+#include "music/transport.hh"
 
 namespace MUSIC {
 
@@ -45,6 +50,12 @@ namespace MUSIC {
 
     void tick ();
 
+    // Equivalent to calling tick () n times
+    void ticks (int n);
+
+    // Equivalent to calling tick () while time () < t
+    void tickUntil (double t);
+
     double time ();
     
   private:
@@ -52,8 +63,24 @@ namespace MUSIC {
     MPI::Intracomm comm;
     std::vector<TickingPort*> tickingPorts;
     std::vector<Connector*> connectors;
+    std::vector<MPI::Intercomm> intercomms;
+    // Transports over comm and intercomms, used by the connectors
+    std::vector<Transport*> transports;
+    // Windows for RMA cont connections, at most one per intercomm
+    std::vector<RMAWindow*> rmaWindows;
     std::vector<Subconnector*> schedule;
     std::vector<PostCommunicationConnector*> postCommunication;
+    // Unless some ticking port or connector needs to run on every
+    // tick, ticks before nextActive_ only advance localTime
+    bool tickEveryStep_;
+    ClockState nextActive_;
+    // For the statistics report
+    std::string applicationName_;
+    std::string statistics_;	// "stderr", a file name or empty
+    double startTime_;
+    double tickTime_;
+    std::string trace_;		// trace file name or empty
+    std::string communicationMatrix_; // file name or empty
     static bool isInstantiated_;
 
     typedef std::vector<Connection*> Connections;
@@ -61,16 +88,43 @@ namespace MUSIC {
     typedef std::vector<InputSubconnector*> InputSubconnectors;
     
     void takeTickingPorts (Setup* s);
-    void connectToPeers (Connections* connections);
+    void connectToPeers (Setup* s, Connections* connections);
+    int sharedMemoryRing (Setup* s);
+    std::set<std::pair<int, int> > globalPairs (int localLeader,
+						std::set<int>& remoteLeaders);
+    void createSharedMemoryTransports (int localLeader,
+				       int ringSize,
+				       std::map<int, MPI::Intercomm>& peers,
+				       std::map<int, Transport*>& peerTransports);
+    void createRMAWindows (int localLeader,
+			   std::set<int>& rmaPeers,
+			   std::map<int, MPI::Intercomm>& peers,
+			   std::map<int, RMAWindow*>& peerWindows);
+    std::set<std::string> rmaPorts (Setup* s);
+    bool usesRMA (Connector* connector, std::set<std::string>& selected);
+    void checkTagRange (int maxPortCode);
     void specializeConnectors (Connections* connections);
-    void spatialNegotiation (OutputSubconnectors&, InputSubconnectors&);
+    NegotiationCache* maybeLoadNegotiationCache (Setup* s,
+						 Connections* connections);
+    void spatialNegotiation (OutputSubconnectors&,
+			     InputSubconnectors&,
+			     NegotiationCache* cache);
     void buildSchedule (int localRank,
 			OutputSubconnectors&,
 			InputSubconnectors&);
     void takePostCommunicators ();
     void buildTables (Setup* s);
-    void temporalNegotiation (Setup* s, Connections* connections);
+    void temporalNegotiation (Setup* s,
+			      Connections* connections,
+			      NegotiationCache* cache);
     void initialize ();
+    void updateNextActive ();
+    void checkGlobalVariables (Setup* s);
+    void enableTrace (Setup* s);
+    void maybeStartWatchdog (Setup* s);
+    void reportStatistics ();
+    void writeCommunicationMatrix ();
+    long long idleTicks ();
   };
 
 }
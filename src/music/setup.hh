@@ -97,9 +97,12 @@ namespace MUSIC {
     friend class InputRedistributionPort;
     friend class TemporalNegotiator;
     friend class ApplicationNode;
+    friend class NegotiationCache;
     
     double timebase () { return timebase_; }
 
+    Configuration* configuration () { return config_; }
+
     bool launchedByMusic ();
 
     void init (int& argc, char**& argv);
@@ -138,6 +141,7 @@ namespace MUSIC {
     TemporalNegotiator* temporalNegotiator () { return temporalNegotiator_; }
     
     void errorChecks ();
+    void configureLog ();
   };
   
 }
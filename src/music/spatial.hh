@@ -23,6 +23,7 @@
 #include <memory>
 
 #include <music/index_map.hh>
+#include <music/transport.hh>
 
 namespace MUSIC {
 
@@ -116,7 +117,7 @@ namespace MUSIC {
 
   class SpatialNegotiator {
   protected:
-    MPI::Intracomm comm;
+    Transport* comm;
     IndexMap* indices;
     Index::Type type;
     std::vector<NegotiationIntervals> remote;
@@ -124,19 +125,22 @@ namespace MUSIC {
     int maxLocalWidth_;
     unsigned int localRank;
     unsigned int nProcesses;
+    int receiverPortCode_; // separates traffic on a shared transport
     Connector* connector_; // used only for debugging
   public:
     SpatialNegotiator (IndexMap* indices, Index::Type type);
     virtual ~SpatialNegotiator ();
     void negotiateWidth ();
     int maxLocalWidth () { return maxLocalWidth_; }
+    IndexMap* indexMap () { return indices; }
+    Index::Type indexType () { return type; }
     NegotiationIterator wrapIntervals (IndexMap::iterator beg,
 				       IndexMap::iterator end,
 				       Index::Type type,
 				       int rank);
-    void send (MPI::Comm& comm, int destRank,
+    void send (Transport* comm, int destRank, int tag,
 	       NegotiationIntervals& intervals);
-    void receive (MPI::Comm& comm, int sourceRank,
+    void receive (Transport* comm, int sourceRank, int tag,
 		  NegotiationIntervals& intervals);
     void allToAll (std::vector<NegotiationIntervals>& out,
 		   std::vector<NegotiationIntervals>& in);
@@ -152,9 +156,10 @@ namespace MUSIC {
 			      NegotiationIterator dest,
 			      std::vector<NegotiationIntervals>& buffers);
   public:
-    virtual NegotiationIterator negotiate (MPI::Intracomm comm,
-					   MPI::Intercomm intercomm,
+    virtual NegotiationIterator negotiate (Transport* comm,
+					   Transport* intercomm,
 					   int remoteNProc,
+					   int receiverPortCode,
 					   Connector* connector) = 0;
   };
 
@@ -164,10 +169,11 @@ namespace MUSIC {
     std::vector<NegotiationIntervals> results;
   public:
     SpatialOutputNegotiator (IndexMap* indices, Index::Type type);
-    void negotiateWidth (MPI::Intercomm c);
-    NegotiationIterator negotiate (MPI::Intracomm comm,
-				   MPI::Intercomm intercomm,
+    void negotiateWidth (Transport* intercomm);
+    NegotiationIterator negotiate (Transport* comm,
+				   Transport* intercomm,
 				   int remoteNProc,
+				   int receiverPortCode,
 				   Connector* connector);
   };
 
@@ -175,10 +181,11 @@ namespace MUSIC {
   class SpatialInputNegotiator : public SpatialNegotiator {
   public:
     SpatialInputNegotiator (IndexMap* indices, Index::Type type);
-    void negotiateWidth (MPI::Intercomm c);
-    NegotiationIterator negotiate (MPI::Intracomm comm,
-				   MPI::Intercomm intercomm,
+    void negotiateWidth (Transport* intercomm);
+    NegotiationIterator negotiate (Transport* comm,
+				   Transport* intercomm,
 				   int remoteNProc,
+				   int receiverPortCode,
 				   Connector* connector);
   };
 
@@ -0,0 +1,100 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef MUSIC_STATISTICS_HH
+
+#include <mpi.h>
+
+#include <map>
+#include <string>
+#include <vector>
+#include <ostream>
+
+namespace MUSIC {
+
+  // Counters of one Subconnector.  Blocked time is the time spent in
+  // MPI send and receive calls, including waiting for the peer.
+  class CommunicationStatistics {
+  public:
+    long long messages;
+    long long bytes;
+    long long events;
+    double blockedTime;
+    CommunicationStatistics ()
+      : messages (0), bytes (0), events (0), blockedTime (0.0) { }
+    void message (int size)
+    {
+      ++messages;
+      bytes += size;
+    }
+  };
+
+
+  // Time spent by one Connector moving data between the application
+  // and the communication buffers
+  class ConnectorStatistics {
+  public:
+    double sampleTime;
+    double interpolateTime;
+    double distributeTime;
+    double collectTime;
+    ConnectorStatistics ()
+      : sampleTime (0.0), interpolateTime (0.0),
+	distributeTime (0.0), collectTime (0.0) { }
+  };
+
+
+  // A table of values, one row per quantity, which is summarized
+  // over the processes of an application as min, mean and max.  All
+  // processes must add the same rows in the same order.
+
+  class StatisticsReport {
+    MPI::Intracomm comm_;
+    std::vector<std::string> labels_;
+    std::vector<double> values_;
+  public:
+    StatisticsReport (MPI::Intracomm comm) : comm_ (comm) { }
+    void add (std::string label, double value);
+    // Collective.  Only the leader writes.
+    void write (std::ostream& out, std::string heading);
+  };
+
+
+  // Collective over COMM_WORLD.  Returns, in the process of world
+  // rank 0, the strings of all processes in order of rank, and an
+  // empty vector elsewhere.
+  std::vector<std::string> gatherToRoot (const std::string& local);
+
+
+  // Traffic sent by this process, keyed by the rank of the receiver
+  // in COMM_WORLD
+
+  class CommunicationMatrix {
+    std::map<int, CommunicationStatistics> sent_;
+  public:
+    void add (int remoteWorldRank, const CommunicationStatistics& stats);
+    // Collective over COMM_WORLD.  World rank 0 writes one CSV line
+    // per pair of processes which communicated.
+    void write (std::string fileName);
+  };
+
+}
+
+#define MUSIC_STATISTICS_HH
+#endif
@@ -23,10 +23,15 @@
 #include <string>
 
 #include <music/synchronizer.hh>
+#include <music/adaptive_buffering.hh>
 #include <music/FIBO.hh>
 #include <music/BIFO.hh>
 #include <music/event.hh>
+#include <music/event_aggregation.hh>
 #include <music/message.hh>
+#include <music/communication.hh>
+#include <music/statistics.hh>
+#include <music/transport.hh>
 
 namespace MUSIC {
 
@@ -38,22 +43,26 @@ namespace MUSIC {
 
   // The subconnector is responsible for the local side of the
   // communication between two MPI processes, one for each port of a
-  // port pair.  It is created in connector::connect ().
+  // port pair.  It is created in connector::connect ().  Traffic goes
+  // through the transport shared by all subconnectors between the
+  // same pair of applications.
   
   class Subconnector {
   private:
   protected:
     Synchronizer* synch;
-    MPI::Intercomm intercomm;
+    Transport* transport;
     int remoteRank_;		// rank in inter-communicatir
     int remoteWorldRank_;	// rank in COMM_WORLD
     int receiverRank_;
     int receiverPortCode_;
     bool flushed;
+    CommunicationStatistics stats_;
+    int tag (MessageTag t) { return portTag (receiverPortCode_, t); }
   public:
     Subconnector () { }
     Subconnector (Synchronizer* synch,
-		  MPI::Intercomm intercomm,
+		  Transport* transport,
 		  int remoteLeader,
 		  int remoteRank,
 		  int receiverRank,
@@ -66,6 +75,7 @@ namespace MUSIC {
     int remoteWorldRank () const { return remoteWorldRank_; }
     int receiverRank () const { return receiverRank_; }
     int receiverPortCode () const { return receiverPortCode_; }
+    CommunicationStatistics& statistics () { return stats_; }
   };
   
   class OutputSubconnector : virtual public Subconnector {
@@ -100,14 +110,14 @@ namespace MUSIC {
 				 public ContSubconnector {
   public:
     ContOutputSubconnector (Synchronizer* synch,
-			    MPI::Intercomm intercomm,
+			    Transport* transport,
 			    int remoteLeader,
 			    int remoteRank,
 			    int receiverPortCode,
 			    MPI::Datatype type);
     void initialCommunication ();
     void maybeCommunicate ();
-    void send ();
+    virtual void send ();
     void flush (bool& dataStillFlowing);
   };
   
@@ -117,7 +127,7 @@ namespace MUSIC {
     BIFO buffer_;
   public:
     ContInputSubconnector (Synchronizer* synch,
-			   MPI::Intercomm intercomm,
+			   Transport* transport,
 			   int remoteLeader,
 			   int remoteRank,
 			   int receiverRank,
@@ -126,6 +136,50 @@ namespace MUSIC {
     BIFO* buffer () { return &buffer_; }
     void initialCommunication ();
     void maybeCommunicate ();
+    virtual void receive ();
+    void flush (bool& dataStillFlowing);
+  };
+
+  // Cont subconnectors which let the sender put data straight into
+  // the BIFO of the receiver through an RMAWindow.  For each block,
+  // the receiver sends a credit with the address of the free space in
+  // its BIFO and its size.  The sender puts up to that much there and
+  // answers with a notice of the number of bytes written and whether
+  // more follow, or -1 when flushing.  The receiver posts the credit
+  // for the next communication as soon as it is done with the
+  // current one, so the sender normally doesn't wait.
+
+  class ContRMAOutputSubconnector : public ContOutputSubconnector {
+    RMAWindow* window_;
+  public:
+    ContRMAOutputSubconnector (Synchronizer* synch,
+			       Transport* transport,
+			       RMAWindow* window,
+			       int remoteLeader,
+			       int remoteRank,
+			       int receiverPortCode,
+			       MPI::Datatype type);
+    void send ();
+    void flush (bool& dataStillFlowing);
+  };
+
+  class ContRMAInputSubconnector : public ContInputSubconnector {
+    RMAWindow* window_;
+    void* attached_;
+    int attachedSize_;
+    bool creditPosted_;
+    void postCredit ();
+  public:
+    ContRMAInputSubconnector (Synchronizer* synch,
+			      Transport* transport,
+			      RMAWindow* window,
+			      int remoteLeader,
+			      int remoteRank,
+			      int receiverRank,
+			      int receiverPortCode,
+			      MPI::Datatype type);
+    void initialCommunication ();
+    void maybeCommunicate ();
     void receive ();
     void flush (bool& dataStillFlowing);
   };
@@ -133,16 +187,20 @@ namespace MUSIC {
   class EventSubconnector : virtual public Subconnector {
   protected:
     static const int FLUSH_MARK = -1;
+    // Last event of a packet carrying a new maxBuffered in t
+    static const int BUFFERING_MARK = -2;
   };
   
   class EventOutputSubconnector : public BufferingOutputSubconnector,
 				  public EventSubconnector {
+    AdaptiveBuffering* adaptive_;
   public:
     EventOutputSubconnector (Synchronizer* synch,
-			     MPI::Intercomm intercomm,
+			     Transport* transport,
 			     int remoteLeader,
 			     int remoteRank,
-			     int receiverPortCode);
+			     int receiverPortCode,
+			     AdaptiveBuffering* adaptive);
     void maybeCommunicate ();
     void send ();
     void flush (bool& dataStillFlowing);
@@ -152,7 +210,7 @@ namespace MUSIC {
 				 public EventSubconnector {
   public:
     EventInputSubconnector (Synchronizer* synch,
-			    MPI::Intercomm intercomm,
+			    Transport* transport,
 			    int remoteLeader,
 			    int remoteRank,
 			    int receiverRank,
@@ -167,7 +225,7 @@ namespace MUSIC {
     static EventHandlerGlobalIndexDummy dummyHandler;
   public:
     EventInputSubconnectorGlobal (Synchronizer* synch,
-				  MPI::Intercomm intercomm,
+				  Transport* transport,
 				  int remoteLeader,
 				  int remoteRank,
 				  int receiverRank,
@@ -182,7 +240,7 @@ namespace MUSIC {
     static EventHandlerLocalIndexDummy dummyHandler;
   public:
     EventInputSubconnectorLocal (Synchronizer* synch,
-				 MPI::Intercomm intercomm,
+				 Transport* transport,
 				 int remoteLeader,
 				 int remoteRank,
 				 int receiverRank,
@@ -192,6 +250,42 @@ namespace MUSIC {
     void flush (bool& dataStillFlowing);
   };
 
+  // Subconnectors of the node leaders of an aggregated event
+  // connection (see event_aggregation.hh), one for each remote node
+  // leader.  A packet is sent at every communication, even if empty,
+  // and a packet with a block for FLUSH_MARK flushes.
+
+  class AggregatedEventOutputSubconnector : public OutputSubconnector,
+					    public EventSubconnector {
+    EventOutputAggregator* aggregator_;
+    void send (std::vector<char>& packet);
+  public:
+    AggregatedEventOutputSubconnector (Synchronizer* synch,
+				       Transport* transport,
+				       EventOutputAggregator* aggregator,
+				       int remoteLeader,
+				       int remoteRank,
+				       int receiverPortCode);
+    void maybeCommunicate ();
+    void flush (bool& dataStillFlowing);
+  };
+
+  class AggregatedEventInputSubconnector : public InputSubconnector,
+					   public EventSubconnector {
+    EventInputAggregator* aggregator_;
+    void receive (bool deliver);
+  public:
+    AggregatedEventInputSubconnector (Synchronizer* synch,
+				      Transport* transport,
+				      EventInputAggregator* aggregator,
+				      int remoteLeader,
+				      int remoteRank,
+				      int receiverRank,
+				      int receiverPortCode);
+    void maybeCommunicate ();
+    void flush (bool& dataStillFlowing);
+  };
+
   class MessageSubconnector : virtual public Subconnector {
   protected:
     static const int FLUSH_MARK = -1;
@@ -202,7 +296,7 @@ namespace MUSIC {
     FIBO* buffer_;
   public:
     MessageOutputSubconnector (Synchronizer* synch,
-			       MPI::Intercomm intercomm,
+			       Transport* transport,
 			       int remoteLeader,
 			       int remoteRank,
 			       int receiverPortCode,
@@ -218,7 +312,7 @@ namespace MUSIC {
     static MessageHandlerDummy dummyHandler;
   public:
     MessageInputSubconnector (Synchronizer* synch,
-			      MPI::Intercomm intercomm,
+			      Transport* transport,
 			      int remoteLeader,
 			      int remoteRank,
 			      int receiverRank,
@@ -54,6 +54,14 @@ namespace MUSIC {
     // sender side ticks
     int maxBuffered_;
 
+    // the value of maxBuffered_ given by temporal negotiation; this
+    // is the most we can buffer without violating loop constraints
+    int bufferLimit_;
+
+    // number of communications between renegotiations of
+    // maxBuffered_ in adaptive buffering mode; 0 if not adaptive
+    int adaptiveInterval_;
+
     // interpolate rather than picking value closest in time
     bool interpolate_;
 
@@ -63,18 +71,28 @@ namespace MUSIC {
     
     void nextCommunication ();
   public:
+    Synchronizer () : adaptiveInterval_ (0) { }
     virtual ~Synchronizer() { };
     void setLocalTime (Clock* lt);
     virtual void setSenderTickInterval (ClockState ti);
     virtual void setReceiverTickInterval (ClockState ti);
     void setMaxBuffered (int m);
     int allowedBuffered () { return maxBuffered_; }
+    int bufferLimit () { return bufferLimit_; }
+    // Change maxBuffered between communications, within bufferLimit
+    void adaptMaxBuffered (int m);
+    void setAdaptiveInterval (int n) { adaptiveInterval_ = n; }
+    int adaptiveInterval () { return adaptiveInterval_; }
+    Clock& localClock () { return *localTime; }
     void setAccLatency (ClockState l);
     ClockState delay () { return latency_; }
     void setInterpolate (bool flag);
     virtual void initialize ();
     virtual int initialBufferedTicks () { return 0; };
     bool communicate ();
+    // Earliest local time at which tick () does more than find that
+    // it is not yet time to communicate
+    virtual ClockState nextActiveTime () { return localTime->integerTime (); }
   };
 
 
@@ -82,6 +100,7 @@ namespace MUSIC {
   public:
     bool sample ();
     void tick ();
+    ClockState nextActiveTime () { return nextSend.integerTime (); }
   };
 
 
@@ -89,6 +108,7 @@ namespace MUSIC {
   public:
     virtual int initialBufferedTicks ();
     void tick ();
+    ClockState nextActiveTime () { return nextReceive.integerTime (); }
   };
 
 
@@ -22,6 +22,7 @@
 #define DEFAULT_PACKET_SIZE 64000
 #define EVENT_FREQUENCY_ESTIMATE 10.0
 #define DEFAULT_MESSAGE_MAX_BUFFERED 10
+#define SOLVER_RANK 0 // rank in negotiationComm
 
 #include <music/clock.hh>
 #include <music/connection.hh>
@@ -37,6 +38,7 @@ namespace MUSIC {
     int maxBuffered;
     int defaultMaxBuffered; // not used for input connections
     bool interpolate;
+    int adaptiveInterval; // 0 unless adaptive buffering
     ClockState accLatency;
     ClockState remoteTickInterval;
   };
@@ -52,8 +54,6 @@ namespace MUSIC {
 
   class ApplicationNode;
 
-  class ConnectionEdge;
-
   // The TemporalNegotiator negotiates communication timing parameters
   // with all other applications.
   
@@ -66,10 +66,11 @@ namespace MUSIC {
     int nApplications; // initialized by createNegotiationCommunicator
     int nLocalConnections;
     int localNode;
-    double timebase;
     std::vector<OutputConnection> outputConnections;
     std::vector<InputConnection> inputConnections;
-    std::vector<ApplicationNode> nodes;
+    std::vector<ApplicationNode> nodes; // only in the solver
+    std::vector<int> blockSizes;
+    std::vector<int> blockDisplacements;
     TemporalNegotiationData* negotiationBuffer;
     TemporalNegotiationData* negotiationData;
     int negotiationDataSize (int nConnections);
@@ -77,15 +78,15 @@ namespace MUSIC {
     int computeDefaultMaxBuffered (int maxLocalWidth,
 				   int eventSize,
 				   ClockState tickInterval,
-				   double timebase);
+				   double timebase,
+				   double eventRate);
     TemporalNegotiationData* allocNegotiationData (int nBlocks,
 						   int nConnections);
     void freeNegotiationData (TemporalNegotiationData*);
     ConnectionDescriptor* findInputConnection (int node, int port);
     bool isLeader ();
     bool hasPeers ();
-    void depthFirst (ApplicationNode& x,
-		     std::vector<ConnectionEdge>& path);
+    bool isSolver ();
   public:
     TemporalNegotiator (Setup* setup);
     ~TemporalNegotiator ();
@@ -94,7 +95,8 @@ namespace MUSIC {
     void separateConnections (std::vector<Connection*>* connections);
     void createNegotiationCommunicator ();
     void collectNegotiationData (ClockState ti);
-    void communicateNegotiationData ();
+    void gatherNegotiationData ();
+    void scatterNegotiationData ();
     void combineParameters ();
     void loopAlgorithm ();
     void distributeParameters ();
@@ -102,22 +104,10 @@ namespace MUSIC {
     void receiveNegotiationData ();
     void distributeNegotiationData (Clock& localTime);
     void negotiate (Clock& localTime, std::vector<Connection*>* connections);
-  };
-
-  class ConnectionEdge {
-    ApplicationNode* pre_;
-    ApplicationNode* post_;
-    ConnectionDescriptor* connection_;
-  public:
-    ConnectionEdge (ApplicationNode& preNode,
-		    ApplicationNode& postNode,
-		    ConnectionDescriptor& descr)
-      : pre_ (&preNode), post_ (&postNode), connection_ (&descr) { }
-    ApplicationNode& pre () { return *pre_; }
-    ApplicationNode& post () { return *post_; }
-    ClockState latency () { return connection_->accLatency;}
-    int allowedBuffer () { return connection_->maxBuffered; }
-    void setAllowedBuffer (int a) { connection_->maxBuffered = a; }
+    void negotiationResult (std::vector<char>& result);
+    void restore (Clock& localTime,
+		  std::vector<Connection*>* connections,
+		  std::vector<char>& result);
   };
 
   class ApplicationNode {
@@ -127,24 +117,11 @@ namespace MUSIC {
     ApplicationNode (TemporalNegotiator* negotiator,
 		     int i,
 		     TemporalNegotiationData* data_)
-      : negotiator_ (negotiator), index (i), data (data_)
-    {
-      visited = false;
-      inPath = false;
-    }
+      : negotiator_ (negotiator), index (i), data (data_) { }
     TemporalNegotiationData* data;
-    bool visited;
-    bool inPath;
     std::string name ();
     ClockState tickInterval () { return data->tickInterval; }
     int nConnections () { return data->nOutConnections; }
-    ConnectionEdge connection (int c)
-    {
-      ConnectionDescriptor& descr = data->connection[c];
-      return ConnectionEdge (*this,
-			     negotiator_->applicationNode (descr.remoteNode),
-			     descr);
-    };
   };
 
 }
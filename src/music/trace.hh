@@ -0,0 +1,97 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUSIC_TRACE_HH
+
+#include <mpi.h>
+
+#include <string>
+#include <vector>
+
+#define DEFAULT_TRACE_BUFFER 100000
+
+namespace MUSIC {
+
+  // Per-process record of the phases of the Runtime and of the
+  // transfers of the subconnectors.  Records are kept in a ring
+  // buffer, so that only the most recent ones survive a long run,
+  // and are written in the Chrome trace event format by finalize.
+  //
+  // Tracing is switched on by the Runtime constructor.  When it is
+  // off, each trace point costs a test of a static flag.
+
+  class Trace {
+  public:
+    // Complete event in the Chrome sense.  name must be a string
+    // literal since only the pointer is stored.
+    struct Event {
+      const char* name;
+      double start;
+      double duration;
+      int peer;			// rank in COMM_WORLD, -1 for phases
+      int bytes;
+    };
+
+    // Collective over COMM_WORLD
+    static void enable (int capacity);
+    static bool enabled () { return enabled_; }
+    static void record (const char* name,
+			double start,
+			double end,
+			int peer = -1,
+			int bytes = 0);
+
+    // Record the phase which began at start and return its end,
+    // which is the start of the next phase
+    static double phase (const char* name, double start)
+    {
+      if (!enabled_)
+	return start;
+      double end = MPI::Wtime ();
+      record (name, start, end);
+      return end;
+    }
+
+    static void transfer (const char* name,
+			  double start,
+			  double end,
+			  int peer,
+			  int bytes)
+    {
+      if (enabled_)
+	record (name, start, end, peer, bytes);
+    }
+
+    // Collective over COMM_WORLD.  World rank 0 writes the records
+    // of all processes to fileName.
+    static void write (std::string fileName,
+		       std::string applicationName,
+		       MPI::Intracomm comm);
+
+  private:
+    static bool enabled_;
+    static double origin_;
+    static std::vector<Event> events_;
+    static unsigned int next_;
+    static long long nRecorded_;
+  };
+
+}
+
+#define MUSIC_TRACE_HH
+#endif
@@ -0,0 +1,279 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUSIC_TRANSPORT_HH
+
+#include <mpi.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <pthread.h>
+}
+
+namespace MUSIC {
+
+  // A Transport carries the point-to-point traffic of subconnectors
+  // and spatial negotiators.  An inter transport connects the
+  // processes of a pair of applications and ranks name processes of
+  // the remote application.  An intra transport connects the
+  // processes of one application and also offers the collectives
+  // needed by the spatial negotiation.
+  //
+  // Semantics follow MPI: messages between a pair of processes with
+  // the same tag arrive in order, and receive () blocks until a
+  // matching message is available.
+
+  class Transport {
+  public:
+    virtual ~Transport () { }
+    virtual int rank () = 0;
+    virtual int size () = 0;
+    // Size of the remote group (equals size () for intra transports)
+    virtual int remoteSize () = 0;
+    virtual void send (const void* buffer,
+		       int count,
+		       MPI::Datatype type,
+		       int dest,
+		       int tag) = 0;
+    // Returns the number of bytes received
+    virtual int receive (void* buffer,
+			 int count,
+			 MPI::Datatype type,
+			 int source,
+			 int tag) = 0;
+    // True if a message from source with tag can be received
+    virtual bool probe (int source, int tag) = 0;
+
+    // Collectives over the local group of an intra transport
+    virtual void allreduceMax (int* local, int* global, int count) = 0;
+    virtual void broadcast (void* buffer,
+			    int count,
+			    MPI::Datatype type,
+			    int root) = 0;
+
+    // Releases resources which must be freed before MPI is
+    // finalized.  This may be collective, so transports are closed in
+    // the order they were created.
+    virtual void close () { }
+  };
+
+
+  class MPIIntracommTransport : public Transport {
+    MPI::Intracomm comm_;
+  public:
+    MPIIntracommTransport (MPI::Intracomm comm) : comm_ (comm) { }
+    int rank () { return comm_.Get_rank (); }
+    int size () { return comm_.Get_size (); }
+    int remoteSize () { return comm_.Get_size (); }
+    void send (const void* buffer, int count, MPI::Datatype type,
+	       int dest, int tag);
+    int receive (void* buffer, int count, MPI::Datatype type,
+		 int source, int tag);
+    bool probe (int source, int tag);
+    void allreduceMax (int* local, int* global, int count);
+    void broadcast (void* buffer, int count, MPI::Datatype type, int root);
+  };
+
+
+  class MPIIntercommTransport : public Transport {
+    MPI::Intercomm comm_;
+  public:
+    MPIIntercommTransport (MPI::Intercomm comm) : comm_ (comm) { }
+    int rank () { return comm_.Get_rank (); }
+    int size () { return comm_.Get_size (); }
+    int remoteSize () { return comm_.Get_remote_size (); }
+    void send (const void* buffer, int count, MPI::Datatype type,
+	       int dest, int tag);
+    int receive (void* buffer, int count, MPI::Datatype type,
+		 int source, int tag);
+    bool probe (int source, int tag);
+    void allreduceMax (int* local, int* global, int count);
+    void broadcast (void* buffer, int count, MPI::Datatype type, int root);
+  };
+
+
+  // A SharedMemoryTransport connects the processes of a pair of
+  // applications like an MPIIntercommTransport, but messages between
+  // processes on the same node bypass MPI.  For each direction
+  // between a pair of co-located processes, there is a
+  // single-producer/single-consumer ring in an MPI-3 shared memory
+  // window, allocated by the receiver.  The sender copies into the
+  // ring and the receiver copies out of it directly into the
+  // destination buffer, such as a BIFO block.  Messages larger than
+  // the ring are streamed through it.  Messages for other tags than
+  // the one received or probed for are moved aside to a queue.
+  //
+  // As with MPI, a send may block until the receiver makes room, so
+  // communication patterns which are free from deadlocks under MPI
+  // are free from deadlocks here.  Datatypes must be contiguous.
+
+  const int SHARED_MEMORY_RING_MIN = 1024;
+
+  class SharedMemoryTransport : public Transport {
+  public:
+    // Collective over both applications of intercomm.  high must
+    // differ between the two applications.  ringSize is the number of
+    // bytes in each ring.
+    SharedMemoryTransport (MPI::Intercomm intercomm, bool high, int ringSize);
+    int rank () { return mpi_.rank (); }
+    int size () { return mpi_.size (); }
+    int remoteSize () { return mpi_.remoteSize (); }
+    void send (const void* buffer, int count, MPI::Datatype type,
+	       int dest, int tag);
+    int receive (void* buffer, int count, MPI::Datatype type,
+		 int source, int tag);
+    bool probe (int source, int tag);
+    void allreduceMax (int* local, int* global, int count);
+    void broadcast (void* buffer, int count, MPI::Datatype type, int root);
+    void close ();
+    // Number of remote processes reached through shared memory
+    int nColocated () { return nColocated_; }
+
+  private:
+    struct RingHeader;
+    struct MessageHeader {
+      int tag;
+      int size;
+    };
+    struct Message {
+      int tag;
+      std::string data;
+    };
+    MPIIntercommTransport mpi_;
+    int ringSize_;
+    int nColocated_;
+    bool open_;
+    MPI_Comm nodeComm_;
+    MPI_Win window_;
+    // Rings indexed by remote rank, NULL for processes on other nodes
+    std::vector<char*> outRings_;
+    std::vector<char*> inRings_;
+    std::vector<std::deque<Message> > unexpected_;
+    void sync ();
+    void write (char* ring, const char* data, int size);
+    void read (char* ring, char* data, int size);
+    bool peek (char* ring, MessageHeader& message);
+    void moveAside (char* ring, MessageHeader& message, int source);
+  };
+
+
+  // An RMAWindow is an MPI-3 dynamic window spanning the processes of
+  // a pair of applications.  Receivers attach the memory they want
+  // written and senders put data into it with passive target
+  // synchronization.  Notifying the receiver that a put is complete
+  // is left to the user, typically by a message through a Transport.
+  // Ranks and addresses are those of the remote application.
+
+  class RMAWindow {
+  public:
+    // Collective over both applications of intercomm.  high must
+    // differ between the two applications.
+    RMAWindow (MPI::Intercomm intercomm, bool high);
+    void attach (void* base, int size);
+    void detach (void* base);
+    // The address of p to be used by the remote side in put ()
+    long long address (void* p);
+    // Writes size bytes at address in process rank.  The data is in
+    // place when put () returns.
+    void put (const void* data, int size, int rank, long long address);
+    // Makes data put by the remote side visible locally
+    void sync ();
+    // Collective like the constructor
+    void close ();
+  private:
+    MPI::Intracomm comm_;
+    int remoteOffset_;
+    bool open_;
+    MPI_Win window_;
+  };
+
+
+  // A LocalNetwork connects groups of endpoints within one process,
+  // typically driven by one thread per endpoint.  Each endpoint has
+  // a mailbox of messages.  Sends are buffered and never block, so
+  // communication patterns which are free from deadlocks under MPI
+  // are free from deadlocks here.  Delivery order only depends on
+  // the order of sends, which makes runs reproducible.
+  //
+  // Only the size of the datatype is used, so data is copied as
+  // bytes.
+
+  class LocalNetwork {
+  public:
+    LocalNetwork ();
+    ~LocalNetwork ();
+    // Returns the id of a new group of size endpoints
+    int addGroup (int size);
+    int groupSize (int group) { return groups_[group]; }
+
+    void send (int sourceGroup, int source, int destGroup, int dest,
+	       int tag, const void* data, int size);
+    int receive (int destGroup, int dest, int sourceGroup, int source,
+		 int tag, void* data, int maxSize);
+    bool probe (int destGroup, int dest, int sourceGroup, int source,
+		int tag);
+
+  private:
+    struct Message {
+      int sourceGroup;
+      int source;
+      int tag;
+      std::string data;
+    };
+    typedef std::deque<Message> Mailbox;
+    std::vector<int> groups_;
+    std::vector<int> firstMailbox_;
+    std::vector<Mailbox> mailboxes_;
+    pthread_mutex_t mutex_;
+    pthread_cond_t delivered_;
+    Mailbox& mailbox (int group, int rank);
+    Mailbox::iterator find (Mailbox& mailbox, int sourceGroup, int source,
+			    int tag);
+  };
+
+
+  // Endpoint rank of group in a LocalNetwork.  Messages are sent to
+  // and received from remoteGroup, which is group itself for an intra
+  // transport.
+  class LocalTransport : public Transport {
+    LocalNetwork* network_;
+    int group_;
+    int rank_;
+    int remoteGroup_;
+  public:
+    LocalTransport (LocalNetwork* network, int group, int rank,
+		    int remoteGroup);
+    int rank () { return rank_; }
+    int size () { return network_->groupSize (group_); }
+    int remoteSize () { return network_->groupSize (remoteGroup_); }
+    void send (const void* buffer, int count, MPI::Datatype type,
+	       int dest, int tag);
+    int receive (void* buffer, int count, MPI::Datatype type,
+		 int source, int tag);
+    bool probe (int source, int tag);
+    void allreduceMax (int* local, int* global, int count);
+    void broadcast (void* buffer, int count, MPI::Datatype type, int root);
+  };
+
+}
+
+#define MUSIC_TRANSPORT_HH
+#endif
@@ -0,0 +1,77 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MUSIC_WATCHDOG_HH
+
+#include <map>
+#include <string>
+
+namespace MUSIC {
+
+  class Subconnector;
+
+  // Optional thread which reports ticks lasting longer than a
+  // threshold, together with the subconnector the process is blocked
+  // in, if any.  The state shared with the thread is only accessed
+  // under a mutex and the thread makes no MPI calls, so the library
+  // need not be initialized with thread support.
+  //
+  // When the watchdog isn't started, each hook costs a test of a
+  // static flag.
+
+  class Watchdog {
+  public:
+    struct Target {
+      bool output;
+      std::string port;		// receiver application.port
+      std::string remoteApp;
+      int remoteWorldRank;
+      int nStalls;		// stalled ticks spent blocked here
+    };
+
+    static void addTarget (Subconnector* s,
+			   bool output,
+			   std::string port,
+			   std::string remoteApp);
+    static void start (double threshold, std::string applicationName);
+    static void stop ();
+    static bool enabled () { return enabled_; }
+
+    static void beginTick () { if (enabled_) setTick (true); }
+    static void endTick () { if (enabled_) setTick (false); }
+    static void beginWait (Subconnector* s) { if (enabled_) setWait (s); }
+    static void endWait () { if (enabled_) setWait (NULL); }
+
+    // Collective over COMM_WORLD.  World rank 0 writes, for each
+    // pair of applications, the time the processes of the first
+    // spent blocked on the second and the number of stalled ticks.
+    static void writeWaitForGraph ();
+
+  private:
+    static bool enabled_;
+    static std::map<Subconnector*, Target> targets_;
+    static void setTick (bool inTick);
+    static void setWait (Subconnector* s);
+    static void* run (void*);
+    static void report (double stalled, double now);
+  };
+
+}
+
+#define MUSIC_WATCHDOG_HH
+#endif
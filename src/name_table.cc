@@ -0,0 +1,92 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "music/name_table.hh"
+
+namespace MUSIC {
+
+  const int NameTable::NO_ID;
+
+
+  NameTable::NameTable ()
+    : slots_ (16, NO_ID), mask_ (15)
+  {
+  }
+
+
+  // FNV-1a
+  unsigned int
+  NameTable::hash (const std::string& name)
+  {
+    unsigned int h = 2166136261U;
+    for (std::string::const_iterator c = name.begin ();
+	 c != name.end ();
+	 ++c)
+      {
+	h ^= static_cast<unsigned char> (*c);
+	h *= 16777619U;
+      }
+    return h;
+  }
+
+
+  // Linear probing: returns the slot holding name or the empty slot
+  // where it would be inserted
+  unsigned int
+  NameTable::slot (const std::string& name) const
+  {
+    unsigned int s = hash (name) & mask_;
+    while (slots_[s] != NO_ID && names_[slots_[s]] != name)
+      s = (s + 1) & mask_;
+    return s;
+  }
+
+
+  void
+  NameTable::grow ()
+  {
+    slots_.assign (2 * slots_.size (), NO_ID);
+    mask_ = slots_.size () - 1;
+    for (unsigned int id = 0; id < names_.size (); ++id)
+      slots_[slot (names_[id])] = id;
+  }
+
+
+  int
+  NameTable::intern (const std::string& name)
+  {
+    unsigned int s = slot (name);
+    if (slots_[s] != NO_ID)
+      return slots_[s];
+    int id = names_.size ();
+    names_.push_back (name);
+    slots_[s] = id;
+    // Keep the load factor below 1/2
+    if (2 * names_.size () > slots_.size ())
+      grow ();
+    return id;
+  }
+
+
+  int
+  NameTable::find (const std::string& name) const
+  {
+    return slots_[slot (name)];
+  }
+
+}
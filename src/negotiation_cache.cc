@@ -0,0 +1,298 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//#define MUSIC_DEBUG 1
+#include "music/debug.hh"
+
+#include "music/negotiation_cache.hh" // Must be included first on BG/L
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "music/setup.hh"
+#include "music/temporal.hh"
+#include "music/version.hh"
+#include "music/error.hh"
+
+namespace MUSIC {
+
+  static const char cacheMagic[8] = { 'M', 'U', 'S', 'I', 'C', 'N', 'C', '2' };
+
+  // FNV-1a parameters
+  static const unsigned long long hashOffset = 14695981039346656037ULL;
+  static const unsigned long long hashPrime = 1099511628211ULL;
+
+  // Signatures are exchanged as signed long long in validate (), so
+  // we keep them non-negative
+  static const unsigned long long signatureMask = 0x7fffffffffffffffULL;
+
+
+  // Identifies the launch which wrote a set of cache files.  Only
+  // called on rank 0; the result is broadcast in write ().
+  static unsigned long long
+  launchId ()
+  {
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    long long data[3] = { tv.tv_sec, tv.tv_usec, getpid () };
+    const unsigned char* bytes = reinterpret_cast<unsigned char*> (data);
+    unsigned long long id = hashOffset;
+    for (size_t i = 0; i < sizeof (data); ++i)
+      {
+	id ^= bytes[i];
+	id *= hashPrime;
+      }
+    return id & signatureMask;
+  }
+
+
+  NegotiationCache::NegotiationCache (std::string directory,
+				      Setup* s,
+				      Clock& localTime,
+				      std::vector<Connection*>* connections)
+    : signature_ (hashOffset), globalSignature_ (0), launch_ (0),
+      valid_ (false)
+  {
+    int rank = MPI::COMM_WORLD.Get_rank ();
+    int size = MPI::COMM_WORLD.Get_size ();
+    std::ostringstream name;
+    name << directory << "/music-" << rank << ".cache";
+    fileName_ = name.str ();
+
+    // Anything which, if changed, could change the outcome of
+    // negotiation goes into the signature
+    hash (version ());
+    hash (&rank, sizeof (rank));
+    hash (&size, sizeof (size));
+    int layout[2] = { sizeof (SpatialNegotiationData),
+		      sizeof (ConnectionDescriptor) };
+    hash (layout, sizeof (layout));
+    double timebase = localTime.timebase ();
+    hash (&timebase, sizeof (timebase));
+    long long tickInterval = localTime.tickInterval ();
+    hash (&tickInterval, sizeof (tickInterval));
+    std::ostringstream config;
+    s->configuration ()->write (config);
+    hash (config.str ());
+    int nConnections = connections->size ();
+    hash (&nConnections, sizeof (nConnections));
+    for (std::vector<Connection*>::iterator c = connections->begin ();
+	 c != connections->end ();
+	 ++c)
+      hashConnection (*c);
+    signature_ &= signatureMask;
+
+    routing_.resize (nConnections);
+  }
+
+
+  void
+  NegotiationCache::hash (const void* data, size_t size)
+  {
+    const unsigned char* bytes = static_cast<const unsigned char*> (data);
+    for (size_t i = 0; i < size; ++i)
+      {
+	signature_ ^= bytes[i];
+	signature_ *= hashPrime;
+      }
+  }
+
+
+  void
+  NegotiationCache::hashIndexMap (IndexMap* indices, Index::Type type)
+  {
+    int t = type;
+    hash (&t, sizeof (t));
+    for (IndexMap::iterator i = indices->begin ();
+	 i != indices->end ();
+	 ++i)
+      {
+	int interval[3] = { i->begin (), i->end (), i->local () };
+	hash (interval, sizeof (interval));
+      }
+  }
+
+
+  void
+  NegotiationCache::hashConnection (Connection* connection)
+  {
+    Connector* connector = connection->connector ();
+    int info[4] = { connector->receiverPortCode (),
+		    connector->remoteLeader (),
+		    connector->remoteNProcesses (),
+		    connection->maxBuffered () };
+    hash (info, sizeof (info));
+    hash (connector->receiverAppName ());
+    hash (connector->receiverPortName ());
+    OutputConnection* output = dynamic_cast<OutputConnection*> (connection);
+    if (output != NULL)
+      {
+	int elementSize = output->elementSize ();
+	hash (&elementSize, sizeof (elementSize));
+      }
+    else
+      {
+	InputConnection* input = static_cast<InputConnection*> (connection);
+	long long accLatency = input->accLatency ();
+	hash (&accLatency, sizeof (accLatency));
+	bool interpolate = input->interpolate ();
+	hash (&interpolate, sizeof (interpolate));
+      }
+    SpatialNegotiator* spatialNegotiator = connector->spatialNegotiator ();
+    hashIndexMap (spatialNegotiator->indexMap (),
+		  spatialNegotiator->indexType ());
+  }
+
+
+  bool
+  NegotiationCache::read (unsigned long long& globalSignature,
+			  unsigned long long& launch)
+  {
+    std::ifstream in (fileName_.c_str (), std::ios::binary);
+    if (!in)
+      return false;
+    char magic[sizeof (cacheMagic)];
+    unsigned long long signature;
+    in.read (magic, sizeof (magic));
+    in.read (reinterpret_cast<char*> (&signature), sizeof (signature));
+    in.read (reinterpret_cast<char*> (&globalSignature),
+	     sizeof (globalSignature));
+    in.read (reinterpret_cast<char*> (&launch), sizeof (launch));
+    if (!in
+	|| memcmp (magic, cacheMagic, sizeof (magic)) != 0
+	|| signature != signature_)
+      return false;
+
+    int nConnectors;
+    in.read (reinterpret_cast<char*> (&nConnectors), sizeof (nConnectors));
+    if (!in || nConnectors != static_cast<int> (routing_.size ()))
+      return false;
+    for (int c = 0; c < nConnectors; ++c)
+      {
+	int nIntervals;
+	in.read (reinterpret_cast<char*> (&nIntervals), sizeof (nIntervals));
+	if (!in || nIntervals < 0)
+	  return false;
+	routing_[c].resize (nIntervals);
+	if (nIntervals > 0)
+	  in.read (reinterpret_cast<char*> (&routing_[c][0]),
+		   nIntervals * sizeof (SpatialNegotiationData));
+      }
+
+    int temporalSize;
+    in.read (reinterpret_cast<char*> (&temporalSize), sizeof (temporalSize));
+    if (!in || temporalSize < 0)
+      return false;
+    temporal_.resize (temporalSize);
+    if (temporalSize > 0)
+      in.read (&temporal_[0], temporalSize);
+    return static_cast<bool> (in);
+  }
+
+
+  // Collective over COMM_WORLD.  The cache is used only if every
+  // process could read a cache file with matching signature and all
+  // cache files carry the same global signature and launch id, that
+  // is, were written during the same launch.
+  bool
+  NegotiationCache::validate ()
+  {
+    unsigned long long globalSignature = 0;
+    unsigned long long launch = 0;
+    bool ok = read (globalSignature, launch);
+    if (!ok)
+      globalSignature = launch = 0;
+
+    // A single MAX reduction gives us both the max and (negated) min
+    // of the global signatures and launch ids, and whether any
+    // process failed
+    long long local[5] = { static_cast<long long> (globalSignature),
+			   - static_cast<long long> (globalSignature),
+			   static_cast<long long> (launch),
+			   - static_cast<long long> (launch),
+			   ok ? 0 : 1 };
+    long long result[5];
+    MPI::COMM_WORLD.Allreduce (local, result, 5, MPI::LONG_LONG, MPI::MAX);
+    valid_ = (result[4] == 0
+	      && result[0] == - result[1]
+	      && result[2] == - result[3]);
+
+    if (!valid_)
+      {
+	// Negotiation results will be recorded from scratch
+	for (std::vector<NegotiationIntervals>::iterator r = routing_.begin ();
+	     r != routing_.end ();
+	     ++r)
+	  r->clear ();
+	temporal_.clear ();
+      }
+    MUSIC_LOG0 ("negotiation cache " << (valid_ ? "valid" : "invalid"));
+    return valid_;
+  }
+
+
+  // Collective over COMM_WORLD.  Store negotiation results recorded
+  // during this launch.
+  void
+  NegotiationCache::write ()
+  {
+    MPI::COMM_WORLD.Allreduce (&signature_, &globalSignature_, 1,
+			       MPI::UNSIGNED_LONG_LONG, MPI::BXOR);
+    globalSignature_ &= signatureMask;
+    // The global signature alone doesn't tell launches apart
+    if (MPI::COMM_WORLD.Get_rank () == 0)
+      launch_ = launchId ();
+    MPI::COMM_WORLD.Bcast (&launch_, 1, MPI::UNSIGNED_LONG_LONG, 0);
+
+    // Write to a temporary file first so that an interrupted launch
+    // doesn't leave a truncated cache behind
+    std::string tmpName = fileName_ + ".tmp";
+    std::ofstream out (tmpName.c_str (), std::ios::binary);
+    out.write (cacheMagic, sizeof (cacheMagic));
+    out.write (reinterpret_cast<char*> (&signature_), sizeof (signature_));
+    out.write (reinterpret_cast<char*> (&globalSignature_),
+	       sizeof (globalSignature_));
+    out.write (reinterpret_cast<char*> (&launch_), sizeof (launch_));
+    int nConnectors = routing_.size ();
+    out.write (reinterpret_cast<char*> (&nConnectors), sizeof (nConnectors));
+    for (int c = 0; c < nConnectors; ++c)
+      {
+	int nIntervals = routing_[c].size ();
+	out.write (reinterpret_cast<char*> (&nIntervals), sizeof (nIntervals));
+	if (nIntervals > 0)
+	  out.write (reinterpret_cast<char*> (&routing_[c][0]),
+		     nIntervals * sizeof (SpatialNegotiationData));
+      }
+    int temporalSize = temporal_.size ();
+    out.write (reinterpret_cast<char*> (&temporalSize), sizeof (temporalSize));
+    if (temporalSize > 0)
+      out.write (&temporal_[0], temporalSize);
+    out.close ();
+    if (!out || rename (tmpName.c_str (), fileName_.c_str ()) != 0)
+      {
+	// Failing to store the cache is not fatal
+	std::remove (tmpName.c_str ());
+	MUSIC_LOGR ("couldn't write negotiation cache " << fileName_);
+      }
+  }
+
+}
@@ -0,0 +1,109 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <mpi.h>
+
+#include "config.h"
+
+#include "music/transport.hh"
+#include "music/error.hh"
+
+namespace MUSIC {
+
+  RMAWindow::RMAWindow (MPI::Intercomm intercomm, bool high)
+    : open_ (false)
+  {
+#ifdef HAVE_MPI_WIN_CREATE_DYNAMIC
+    // The low group comes first in the merged communicator
+    comm_ = intercomm.Merge (high);
+    remoteOffset_ = high ? 0 : intercomm.Get_size ();
+    MPI_Win_create_dynamic (MPI_INFO_NULL, comm_, &window_);
+    // One passive target epoch to every process lasts until close ()
+    MPI_Win_lock_all (0, window_);
+    open_ = true;
+#else
+    error ("rma_ports requires an MPI library with MPI-3 dynamic windows");
+#endif
+  }
+
+
+  void
+  RMAWindow::close ()
+  {
+#ifdef HAVE_MPI_WIN_CREATE_DYNAMIC
+    if (!open_)
+      return;
+    // Freeing the window detaches all memory
+    MPI_Win_unlock_all (window_);
+    MPI_Win_free (&window_);
+    comm_.Free ();
+    open_ = false;
+#endif
+  }
+
+
+  void
+  RMAWindow::attach (void* base, int size)
+  {
+#ifdef HAVE_MPI_WIN_CREATE_DYNAMIC
+    MPI_Win_attach (window_, base, size);
+#endif
+  }
+
+
+  void
+  RMAWindow::detach (void* base)
+  {
+#ifdef HAVE_MPI_WIN_CREATE_DYNAMIC
+    MPI_Win_detach (window_, base);
+#endif
+  }
+
+
+  long long
+  RMAWindow::address (void* p)
+  {
+    MPI_Aint address;
+    MPI_Get_address (p, &address);
+    return address;
+  }
+
+
+  void
+  RMAWindow::put (const void* data, int size, int rank, long long address)
+  {
+#ifdef HAVE_MPI_WIN_CREATE_DYNAMIC
+    if (size == 0)
+      return;
+    int target = remoteOffset_ + rank;
+    MPI_Put (const_cast<void*> (data), size, MPI_BYTE,
+	     target, address, size, MPI_BYTE, window_);
+    MPI_Win_flush (target, window_);
+#endif
+  }
+
+
+  void
+  RMAWindow::sync ()
+  {
+#ifdef HAVE_MPI_WIN_CREATE_DYNAMIC
+    MPI_Win_sync (window_);
+#endif
+  }
+
+}
@@ -22,9 +22,21 @@
 #include <mpi.h>
 
 #include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
 
 #include "music/runtime.hh"
+#include "music/config_image.hh"
 #include "music/temporal.hh"
+#include "music/negotiation_cache.hh"
+#include "music/communication.hh"
+#include "music/trace.hh"
+#include "music/log.hh"
+#include "music/watchdog.hh"
 #include "music/error.hh"
 
 namespace MUSIC {
@@ -32,6 +44,7 @@ namespace MUSIC {
   bool Runtime::isInstantiated_ = false;
 
   Runtime::Runtime (Setup* s, double h)
+    : tickEveryStep_ (true), startTime_ (0.0), tickTime_ (0.0)
   {
     checkInstantiatedOnce (isInstantiated_, "Runtime");
     s->maybePostponedSetup ();
@@ -44,26 +57,43 @@ namespace MUSIC {
     
     comm = s->communicator ();
 
+    applicationName_ = s->configuration ()->name ();
+    s->config ("statistics", &statistics_);
+    s->config ("trace", &trace_);
+    s->config ("communication_matrix", &communicationMatrix_);
+
     Connections* connections = s->connections ();
     
     if (s->launchedByMusic ())
       {
+	checkGlobalVariables (s);
+	enableTrace (s);
+	double mark = MPI::Wtime ();
+
 	takeTickingPorts (s);
 	
 	// create a total order for connectors and
 	// establish connection to peers
-	connectToPeers (connections);
+	connectToPeers (s, connections);
+	mark = Trace::phase ("connectToPeers", mark);
 	
 	// specialize connectors and fill up connectors vector
 	specializeConnectors (connections);
+	mark = Trace::phase ("specializeConnectors", mark);
 	
 	// from here we can start using the vector `connectors'
 
+	// optionally reuse negotiation results from an earlier launch
+	NegotiationCache* cache = maybeLoadNegotiationCache (s, connections);
+	mark = Trace::phase ("loadNegotiationCache", mark);
+
 	// negotiate where to route data and fill up subconnector vectors
-	spatialNegotiation (outputSubconnectors, inputSubconnectors);
+	spatialNegotiation (outputSubconnectors, inputSubconnectors, cache);
+	mark = Trace::phase ("spatialNegotiation", mark);
 
 	// build data routing tables
 	buildTables (s);
+	mark = Trace::phase ("buildTables", mark);
 
 	// build a total order of subconnectors
 	// for non-blocking pairwise exchange
@@ -72,12 +102,24 @@ namespace MUSIC {
 		       inputSubconnectors);
 	
 	takePostCommunicators ();
+	mark = Trace::phase ("buildSchedule", mark);
 	
 	// negotiate timing constraints for synchronizers
-	temporalNegotiation (s, connections);
+	temporalNegotiation (s, connections, cache);
+
+	if (cache != NULL)
+	  {
+	    if (!cache->isValid ())
+	      cache->write ();
+	    delete cache;
+	  }
+	mark = Trace::phase ("temporalNegotiation", mark);
 	
+	maybeStartWatchdog (s);
+
 	// final initialization before simulation starts
 	initialize ();
+	Trace::phase ("initialize", mark);
       }
     
     delete s;
@@ -98,10 +140,116 @@ namespace MUSIC {
 	 ++connector)
       delete *connector;
 
+    for (std::vector<Transport*>::iterator transport = transports.begin ();
+	 transport != transports.end ();
+	 ++transport)
+      delete *transport;
+
+    for (std::vector<RMAWindow*>::iterator window = rmaWindows.begin ();
+	 window != rmaWindows.end ();
+	 ++window)
+      delete *window;
+
     isInstantiated_ = false;
   }
   
 
+  // Variables which select operations spanning several applications.
+  // They must have the same value in all applications, typically by
+  // being given in the global section of the configuration file.
+  static const char* globalVariables[] = {
+    "negotiation_cache",
+    "trace",
+    "communication_matrix",
+    "watchdog",
+    "shared_memory",
+    "rma_ports",
+    "event_aggregation"
+  };
+
+
+  // Collective over COMM_WORLD.  An application which disagrees with
+  // the others about a global variable would otherwise dead-lock.
+  void
+  Runtime::checkGlobalVariables (Setup* s)
+  {
+    // For each variable, the maximum of its hash (0 if not set) and
+    // of its complement, so that the minimum can be found in the same
+    // reduction
+    int n = sizeof (globalVariables) / sizeof (globalVariables[0]);
+    std::vector<unsigned long long> local (2 * n);
+    for (int i = 0; i < n; ++i)
+      {
+	std::string value;
+	unsigned long long hash = 0;
+	if (s->config (globalVariables[i], &value))
+	  hash = configImageHash (value.data (), value.size ()) | 1;
+	local[2 * i] = hash;
+	local[2 * i + 1] = ~hash;
+      }
+    std::vector<unsigned long long> global (2 * n);
+    MPI::COMM_WORLD.Allreduce (&local[0], &global[0], 2 * n,
+			       MPI::UNSIGNED_LONG_LONG, MPI::MAX);
+    for (int i = 0; i < n; ++i)
+      if (global[2 * i] != ~global[2 * i + 1])
+	error0 (std::string (globalVariables[i])
+		+ " must have the same value in all applications"
+		+ " (give it in the global section)");
+  }
+
+
+  void
+  Runtime::enableTrace (Setup* s)
+  {
+    if (trace_.empty ())
+      return;
+    int capacity;
+    if (!s->config ("trace_buffer", &capacity))
+      capacity = DEFAULT_TRACE_BUFFER;
+    else if (capacity <= 0)
+      error ("trace_buffer must be positive");
+    Trace::enable (capacity);
+  }
+
+
+  // Describe each subconnector to the watchdog
+  void
+  Runtime::maybeStartWatchdog (Setup* s)
+  {
+    double threshold;
+    if (!s->config ("watchdog", &threshold))
+      return;
+    if (threshold <= 0.0)
+      error ("watchdog must be positive");
+
+    std::map<int, std::string> leaderNames;
+    ApplicationMap* apps = s->applicationMap ();
+    for (ApplicationMap::iterator a = apps->begin (); a != apps->end (); ++a)
+      leaderNames[a->leader ()] = a->name ();
+
+    for (std::vector<Subconnector*>::iterator sc = schedule.begin ();
+	 sc != schedule.end ();
+	 ++sc)
+      {
+	bool output = dynamic_cast<OutputSubconnector*> (*sc) != NULL;
+	for (std::vector<Connector*>::iterator c = connectors.begin ();
+	     c != connectors.end ();
+	     ++c)
+	  if ((*c)->receiverPortCode () == (*sc)->receiverPortCode ()
+	      && (dynamic_cast<OutputConnector*> (*c) != NULL) == output)
+	    {
+	      Watchdog::addTarget (*sc,
+				   output,
+				   ((*c)->receiverAppName () + "."
+				    + (*c)->receiverPortName ()),
+				   leaderNames[(*c)->remoteLeader ()]);
+	      break;
+	    }
+      }
+    Watchdog::start (threshold, applicationName_);
+  }
+
+
   void
   Runtime::takeTickingPorts (Setup* s)
   {
@@ -158,7 +306,7 @@ namespace MUSIC {
 
   
   void
-  Runtime::connectToPeers (Connections* connections)
+  Runtime::connectToPeers (Setup* s, Connections* connections)
   {
     // This ordering is necessary so that both sender and receiver
     // in each pair sets up communication at the same point in time
@@ -167,10 +315,252 @@ namespace MUSIC {
     // build_schedule () here.
     //
     sort (connections->begin (), connections->end (), lessConnection);
+
+    // All connectors between the same pair of applications share one
+    // intercommunicator, so we only need one per remote application.
+    // Pairs are created in a global order (by the world ranks of the
+    // two leaders) which is free from dead-locks.  Pairs with
+    // disjoint applications are created in parallel.
+    int localLeader = MPI::COMM_WORLD.Get_rank () - comm.Get_rank ();
+    std::set<std::pair<int, int> > pairs;
+    int maxPortCode = 0;
+    // Both sides of a connection know the receiver port and so agree
+    // on which pairs need an RMA window
+    std::set<std::string> selected = rmaPorts (s);
+    std::set<int> rmaPeers;
+    for (Connections::iterator c = connections->begin ();
+	 c != connections->end ();
+	 ++c)
+      {
+	Connector* connector = (*c)->connector ();
+	int remoteLeader = connector->remoteLeader ();
+	pairs.insert (std::make_pair (std::min (localLeader, remoteLeader),
+				      std::max (localLeader, remoteLeader)));
+	maxPortCode = std::max (maxPortCode, connector->receiverPortCode ());
+	if (usesRMA (connector, selected))
+	  rmaPeers.insert (remoteLeader);
+      }
+    checkTagRange (maxPortCode);
+
+    int ringSize = sharedMemoryRing (s);
+    int aggregationLimit = 0;
+    s->config ("event_aggregation", &aggregationLimit);
+    Transport* localTransport = new MPIIntracommTransport (comm);
+    transports.push_back (localTransport);
+    std::map<int, MPI::Intercomm> peers;
+    std::map<int, Transport*> peerTransports;
+    std::map<int, RMAWindow*> peerWindows;
+    for (std::set<std::pair<int, int> >::iterator p = pairs.begin ();
+	 p != pairs.end ();
+	 ++p)
+      {
+	int remoteLeader = p->first == localLeader ? p->second : p->first;
+	MPI::Intercomm intercomm = comm.Create_intercomm (0,
+							  MPI::COMM_WORLD,
+							  remoteLeader,
+							  CREATE_INTERCOMM_MSG);
+	peers.insert (std::make_pair (remoteLeader, intercomm));
+	intercomms.push_back (intercomm);
+	if (ringSize == 0)
+	  {
+	    Transport* transport = new MPIIntercommTransport (intercomm);
+	    peerTransports.insert (std::make_pair (remoteLeader, transport));
+	    transports.push_back (transport);
+	  }
+      }
+    // shared_memory is global, so either all processes or none get here
+    if (ringSize > 0)
+      createSharedMemoryTransports (localLeader, ringSize,
+				    peers, peerTransports);
+    // rma_ports is global, so either all processes or none get here
+    if (!selected.empty ())
+      createRMAWindows (localLeader, rmaPeers, peers, peerWindows);
+
     for (Connections::iterator c = connections->begin ();
 	 c != connections->end ();
 	 ++c)
-      (*c)->connector ()->createIntercomm ();
+      {
+	Connector* connector = (*c)->connector ();
+	connector->setIntercomm (peers[connector->remoteLeader ()]);
+	connector->setTransports (localTransport,
+				  peerTransports[connector->remoteLeader ()]);
+	if (usesRMA (connector, selected))
+	  connector->setRMAWindow (peerWindows[connector->remoteLeader ()]);
+	EventConnector* eventConnector
+	  = dynamic_cast<EventConnector*> (connector);
+	if (eventConnector != NULL)
+	  eventConnector->setAggregationLimit (aggregationLimit);
+      }
+  }
+
+
+  // Collective over COMM_WORLD.  Returns the pairs (low leader, high
+  // leader) of all processes, given the remote leaders of our own.
+  std::set<std::pair<int, int> >
+  Runtime::globalPairs (int localLeader, std::set<int>& remoteLeaders)
+  {
+    std::vector<int> local;
+    for (std::set<int>::iterator p = remoteLeaders.begin ();
+	 p != remoteLeaders.end ();
+	 ++p)
+      {
+	local.push_back (std::min (localLeader, *p));
+	local.push_back (std::max (localLeader, *p));
+      }
+    int nProcesses = MPI::COMM_WORLD.Get_size ();
+    int size = local.size ();
+    std::vector<int> sizes (nProcesses);
+    MPI::COMM_WORLD.Allgather (&size, 1, MPI::INT, &sizes[0], 1, MPI::INT);
+    std::vector<int> displacements (nProcesses, 0);
+    for (int i = 1; i < nProcesses; ++i)
+      displacements[i] = displacements[i - 1] + sizes[i - 1];
+    int total = displacements.back () + sizes.back ();
+    std::set<std::pair<int, int> > pairs;
+    if (total == 0)
+      return pairs;
+    std::vector<int> all (total);
+    MPI::COMM_WORLD.Allgatherv (local.empty () ? NULL : &local[0],
+				size, MPI::INT,
+				&all[0], &sizes[0], &displacements[0],
+				MPI::INT);
+    for (int i = 0; i < total; i += 2)
+      pairs.insert (std::make_pair (all[i], all[i + 1]));
+    return pairs;
+  }
+
+
+  // Collective over COMM_WORLD.  Open MPI names the shared state of a
+  // window after the context id of its communicator, which may be the
+  // same for disjoint pairs of applications, so windows are created
+  // one at a time, in the same global order everywhere.
+  void
+  Runtime::createRMAWindows (int localLeader,
+			     std::set<int>& rmaPeers,
+			     std::map<int, MPI::Intercomm>& peers,
+			     std::map<int, RMAWindow*>& peerWindows)
+  {
+    std::set<std::pair<int, int> > pairs = globalPairs (localLeader,
+							rmaPeers);
+    for (std::set<std::pair<int, int> >::iterator p = pairs.begin ();
+	 p != pairs.end ();
+	 ++p)
+      {
+	int remoteLeader = p->first == localLeader ? p->second : p->first;
+	if ((p->first == localLeader || p->second == localLeader)
+	    && rmaPeers.find (remoteLeader) != rmaPeers.end ())
+	  {
+	    RMAWindow* window = new RMAWindow (peers[remoteLeader],
+					       localLeader > remoteLeader);
+	    peerWindows.insert (std::make_pair (remoteLeader, window));
+	    rmaWindows.push_back (window);
+	  }
+	MPI::COMM_WORLD.Barrier ();
+      }
+  }
+
+
+  // Collective over COMM_WORLD.  The rings live in windows from
+  // MPI_Win_allocate_shared, which are subject to the same context id
+  // clash as the RMA windows above, so they are created in the same
+  // way.
+  void
+  Runtime::createSharedMemoryTransports (int localLeader,
+					 int ringSize,
+					 std::map<int, MPI::Intercomm>& peers,
+					 std::map<int, Transport*>& peerTransports)
+  {
+    std::set<int> remoteLeaders;
+    for (std::map<int, MPI::Intercomm>::iterator p = peers.begin ();
+	 p != peers.end ();
+	 ++p)
+      remoteLeaders.insert (p->first);
+    std::set<std::pair<int, int> > pairs = globalPairs (localLeader,
+							remoteLeaders);
+    for (std::set<std::pair<int, int> >::iterator p = pairs.begin ();
+	 p != pairs.end ();
+	 ++p)
+      {
+	if (p->first == localLeader || p->second == localLeader)
+	  {
+	    int remoteLeader = (p->first == localLeader
+				? p->second
+				: p->first);
+	    Transport* transport
+	      = new SharedMemoryTransport (peers[remoteLeader],
+					   localLeader > remoteLeader,
+					   ringSize);
+	    peerTransports.insert (std::make_pair (remoteLeader, transport));
+	    transports.push_back (transport);
+	  }
+	MPI::COMM_WORLD.Barrier ();
+      }
+  }
+
+
+  // Receiver ports, as "app.port", whose cont data is put directly
+  // into the receiver's buffers
+  std::set<std::string>
+  Runtime::rmaPorts (Setup* s)
+  {
+    std::set<std::string> ports;
+    std::string list;
+    if (s->config ("rma_ports", &list))
+      {
+	std::istringstream in (list);
+	std::string port;
+	while (in >> port)
+	  ports.insert (port);
+      }
+    return ports;
+  }
+
+
+  bool
+  Runtime::usesRMA (Connector* connector, std::set<std::string>& selected)
+  {
+    std::string port = (connector->receiverAppName () + "."
+			+ connector->receiverPortName ());
+    if (selected.find (port) == selected.end ())
+      return false;
+    if (dynamic_cast<ContConnector*> (connector) == NULL)
+      error ("rma_ports: " + port + " is not a cont port");
+    return true;
+  }
+
+
+  // Size of the rings of shared memory transports, or 0 if they are
+  // not used
+  int
+  Runtime::sharedMemoryRing (Setup* s)
+  {
+    int ringSize;
+    if (!s->config ("shared_memory", &ringSize))
+      return 0;
+    if (ringSize < SHARED_MEMORY_RING_MIN)
+      {
+	std::ostringstream msg;
+	msg << "shared_memory must be at least " << SHARED_MEMORY_RING_MIN;
+	error (msg.str ());
+      }
+    return ringSize;
+  }
+
+
+  // Port traffic is separated by tags (see portTag () in
+  // communication.hh) which must fit below the MPI tag upper bound
+  void
+  Runtime::checkTagRange (int maxPortCode)
+  {
+    int* tagUB;
+    if (!MPI::COMM_WORLD.Get_attr (MPI::TAG_UB, &tagUB))
+      return;
+    if (portTag (maxPortCode, MessageTag (N_MESSAGE_TAGS - 1)) > *tagUB)
+      {
+	std::ostringstream msg;
+	msg << "too many ports (" << maxPortCode + 1
+	    << ") for the MPI tag upper bound " << *tagUB;
+	error0 (msg.str ());
+      }
   }
 
 
@@ -188,19 +578,34 @@ namespace MUSIC {
   }
 
   
+  NegotiationCache*
+  Runtime::maybeLoadNegotiationCache (Setup* s, Connections* connections)
+  {
+    std::string directory;
+    if (!s->config ("negotiation_cache", &directory))
+      return NULL;
+    NegotiationCache* cache
+      = new NegotiationCache (directory, s, localTime, connections);
+    cache->validate ();
+    return cache;
+  }
+
+  
   void
   Runtime::spatialNegotiation (OutputSubconnectors& outputSubconnectors,
-			       InputSubconnectors& inputSubconnectors)
+			       InputSubconnectors& inputSubconnectors,
+			       NegotiationCache* cache)
   {
     // Let each connector pair setup their inter-communicators
     // and create all required subconnectors.
 
-    for (std::vector<Connector*>::iterator c = connectors.begin ();
-	 c != connectors.end ();
-	 ++c)
+    for (unsigned int c = 0; c < connectors.size (); ++c)
       {
+	if (cache != NULL)
+	  connectors[c]->cacheRouting (cache->routing (c), cache->isValid ());
 	// negotiate and fill up vectors passed as arguments
-	(*c)->spatialNegotiation (outputSubconnectors, inputSubconnectors);
+	connectors[c]->spatialNegotiation (outputSubconnectors,
+					   inputSubconnectors);
       }
   }
 
@@ -286,11 +691,22 @@ namespace MUSIC {
 
   
   void
-  Runtime::temporalNegotiation (Setup* s, Connections* connections)
+  Runtime::temporalNegotiation (Setup* s,
+				Connections* connections,
+				NegotiationCache* cache)
   {
+    TemporalNegotiator* negotiator = s->temporalNegotiator ();
+    if (cache != NULL && cache->isValid ())
+      {
+	negotiator->restore (localTime, connections, cache->temporal ());
+	return;
+      }
+    
     // Temporal negotiation is done globally by a serial algorithm
     // which yields the same result in each process
-    s->temporalNegotiator ()->negotiate (localTime, connections);
+    negotiator->negotiate (localTime, connections);
+    if (cache != NULL)
+      negotiator->negotiationResult (cache->temporal ());
   }
 
 
@@ -319,8 +735,16 @@ namespace MUSIC {
     for (c = connectors.begin (); c != connectors.end (); ++c)
       (*c)->prepareForSimulation ();
 
+    tickEveryStep_ = !tickingPorts.empty ();
+    for (c = connectors.begin (); c != connectors.end (); ++c)
+      if (!(*c)->idleBetweenCommunications ())
+	tickEveryStep_ = true;
+
     // compensate for first localTime.tick () in Runtime::tick ()
     localTime.ticks (-1);
+    nextActive_ = localTime.integerTime ();
+
+    startTime_ = MPI::Wtime ();
 
     // the time zero tick () (where we may or may not communicate)
     tick ();
@@ -330,6 +754,11 @@ namespace MUSIC {
   void
   Runtime::finalize ()
   {
+    double mark = MPI::Wtime ();
+    for (std::vector<Connector*>::iterator c = connectors.begin ();
+	 c != connectors.end ();
+	 ++c)
+      (*c)->finalize ();
     bool dataStillFlowing;
     do
       {
@@ -339,6 +768,24 @@ namespace MUSIC {
 	  (*c)->flush (dataStillFlowing);
       }
     while (dataStillFlowing);
+    Trace::phase ("flush", mark);
+
+    if (Watchdog::enabled ())
+      {
+	Watchdog::stop ();
+	Watchdog::writeWaitForGraph ();
+      }
+
+    if (!statistics_.empty ())
+      reportStatistics ();
+
+    if (!communicationMatrix_.empty ())
+      writeCommunicationMatrix ();
+
+    if (Trace::enabled ())
+      Trace::write (trace_, applicationName_, comm);
+
+    Log::flush ();
 
 #if defined (OPEN_MPI) && MPI_VERSION <= 2
     // This is needed in OpenMPI version <= 1.2 for the freeing of the
@@ -346,25 +793,131 @@ namespace MUSIC {
     MPI::COMM_WORLD.Barrier ();
 #endif
     
-    for (std::vector<Connector*>::iterator connector = connectors.begin ();
-	 connector != connectors.end ();
-	 ++connector)
-      (*connector)->freeIntercomm ();
+    for (std::vector<Transport*>::iterator transport = transports.begin ();
+	 transport != transports.end ();
+	 ++transport)
+      (*transport)->close ();
+
+    for (std::vector<RMAWindow*>::iterator window = rmaWindows.begin ();
+	 window != rmaWindows.end ();
+	 ++window)
+      (*window)->close ();
+
+    for (std::vector<MPI::Intercomm>::iterator intercomm = intercomms.begin ();
+	 intercomm != intercomms.end ();
+	 ++intercomm)
+      intercomm->Free ();
     
     MPI::Finalize ();
   }
 
 
+  // Summarize the communication counters of all processes of this
+  // application.  Collective over comm.
+  void
+  Runtime::reportStatistics ()
+  {
+    StatisticsReport report (comm);
+    report.add ("run time (s)", MPI::Wtime () - startTime_);
+    report.add ("time in tick () (s)", tickTime_);
+    for (std::vector<Connector*>::iterator c = connectors.begin ();
+	 c != connectors.end ();
+	 ++c)
+      {
+	bool output = dynamic_cast<OutputConnector*> (*c) != NULL;
+	CommunicationStatistics sum;
+	for (std::vector<Subconnector*>::iterator s = schedule.begin ();
+	     s != schedule.end ();
+	     ++s)
+	  if ((*s)->receiverPortCode () == (*c)->receiverPortCode ()
+	      && (dynamic_cast<OutputSubconnector*> (*s) != NULL) == output)
+	    {
+	      CommunicationStatistics& stats = (*s)->statistics ();
+	      sum.messages += stats.messages;
+	      sum.bytes += stats.bytes;
+	      sum.events += stats.events;
+	      sum.blockedTime += stats.blockedTime;
+	    }
+
+	std::string name = ((*c)->receiverAppName () + "."
+			    + (*c)->receiverPortName ()
+			    + (output ? " sent " : " received "));
+	report.add (name + "messages", sum.messages);
+	report.add (name + "bytes", sum.bytes);
+	if (dynamic_cast<EventConnector*> (*c) != NULL)
+	  report.add (name + "events", sum.events);
+	report.add (name + "blocked (s)", sum.blockedTime);
+	if (dynamic_cast<ContConnector*> (*c) != NULL)
+	  {
+	    ConnectorStatistics& stats = (*c)->statistics ();
+	    std::string prefix = ((*c)->receiverAppName () + "."
+				  + (*c)->receiverPortName () + " ");
+	    if (output)
+	      {
+		report.add (prefix + "sample (s)", stats.sampleTime);
+		report.add (prefix + "distribute (s)", stats.distributeTime);
+	      }
+	    else
+	      report.add (prefix + "collect (s)", stats.collectTime);
+	    report.add (prefix + "interpolate (s)", stats.interpolateTime);
+	  }
+      }
+
+    std::ostringstream heading;
+    heading << "MUSIC statistics for application " << applicationName_
+	    << " (" << comm.Get_size () << " processes)";
+    std::ostringstream out;
+    report.write (out, heading.str ());
+    if (comm.Get_rank () != 0)
+      return;
+    if (statistics_ == "stderr")
+      std::cerr << out.str ();
+    else
+      {
+	// Applications append their reports to the same file
+	std::ofstream file (statistics_.c_str (), std::ios::app);
+	file << out.str ();
+	if (!file)
+	  std::cerr << "MUSIC: couldn't write statistics to "
+		    << statistics_ << std::endl;
+      }
+  }
+
+
+  // Bytes and messages sent from this process to each process in
+  // COMM_WORLD.  Collective over COMM_WORLD.
+  void
+  Runtime::writeCommunicationMatrix ()
+  {
+    CommunicationMatrix matrix;
+    for (std::vector<Subconnector*>::iterator s = schedule.begin ();
+	 s != schedule.end ();
+	 ++s)
+      if (dynamic_cast<OutputSubconnector*> (*s) != NULL)
+	matrix.add ((*s)->remoteWorldRank (), (*s)->statistics ());
+    matrix.write (communicationMatrix_);
+  }
+
+
   void
   Runtime::tick ()
   {
     // Update local time
     localTime.tick ();
+
+    // Nothing is due before nextActive_
+    if (!tickEveryStep_ && localTime.integerTime () < nextActive_)
+      return;
     
+    double start = MPI::Wtime ();
+    Watchdog::beginTick ();
+    double mark = start;
+
     // ContPorts do some per-tick initialization here
     std::vector<TickingPort*>::iterator p;
     for (p = tickingPorts.begin (); p != tickingPorts.end (); ++p)
       (*p)->tick ();
+    mark = Trace::phase ("tickPorts", mark);
 
     // Check if any connector wants to communicate
     bool requestCommunication = false;
@@ -372,6 +925,7 @@ namespace MUSIC {
     std::vector<Connector*>::iterator c;
     for (c = connectors.begin (); c != connectors.end (); ++c)
       (*c)->tick (requestCommunication);
+    mark = Trace::phase ("tickConnectors", mark);
 
     // Communicate data through non-interlocking pair-wise exchange
     if (requestCommunication)
@@ -381,6 +935,7 @@ namespace MUSIC {
 	     s != schedule.end ();
 	     ++s)
 	  (*s)->maybeCommunicate ();
+	mark = Trace::phase ("communicate", mark);
       }
 
     // ContInputConnectors write data to application here
@@ -389,7 +944,85 @@ namespace MUSIC {
 	 c != postCommunication.end ();
 	 ++c)
       (*c)->postCommunication ();
-	
+    Trace::phase ("postCommunication", mark);
+
+    if (!tickEveryStep_)
+      updateNextActive ();
+
+    Watchdog::endTick ();
+    double end = MPI::Wtime ();
+    tickTime_ += end - start;
+    if (Trace::enabled ())
+      Trace::record ("tick", start, end);
+  }
+
+
+  // After a communication, the synchronizer is active on the
+  // following tick, where it advances its schedule.  Otherwise, the
+  // connectors are idle until the earliest scheduled communication.
+  void
+  Runtime::updateNextActive ()
+  {
+    nextActive_ = std::numeric_limits<long long>::max ();
+    for (std::vector<Connector*>::iterator c = connectors.begin ();
+	 c != connectors.end ();
+	 ++c)
+      nextActive_ = std::min (nextActive_,
+			      (*c)->synchronizer ()->nextActiveTime ());
+  }
+
+
+  // Number of following ticks which only advance localTime.
+  // localTime is non-negative after the Runtime constructor, so the
+  // difference can't overflow.
+  long long
+  Runtime::idleTicks ()
+  {
+    if (tickEveryStep_)
+      return 0;
+    ClockState ahead = nextActive_ - localTime.integerTime ();
+    if (ahead <= 0)
+      return 0;
+    return (ahead - 1) / localTime.tickInterval ();
+  }
+
+
+  void
+  Runtime::ticks (int n)
+  {
+    while (n > 0)
+      {
+	// Idle ticks are taken in one step
+	int idle = std::min (idleTicks (), static_cast<long long> (n));
+	localTime.ticks (idle);
+	n -= idle;
+	if (n > 0)
+	  {
+	    tick ();
+	    --n;
+	  }
+      }
+  }
+
+
+  void
+  Runtime::tickUntil (double t)
+  {
+    ClockState ahead
+      = ClockState (t, localTime.timebase ()) - localTime.integerTime ();
+    if (ahead > 0)
+      {
+	ClockState ti = localTime.tickInterval ();
+	long long n = (ahead + ti - 1) / ti;
+	// ticks takes an int, so long runs are taken in chunks
+	while (n > 0)
+	  {
+	    int chunk = std::min (n, static_cast<long long>
+				  (std::numeric_limits<int>::max ()));
+	    ticks (chunk);
+	    n -= chunk;
+	  }
+      }
   }
 
 
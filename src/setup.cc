@@ -76,6 +76,10 @@ namespace MUSIC {
 	if (!config_->postponeSetup ())
 	  fullInit ();
 	comm = MPI::COMM_WORLD.Split (config_->color (), myRank);
+	// The split needs the colors of all processes, so every
+	// process has read its configuration and the images are no
+	// longer needed
+	config_->removeImage ();
       }
     else
       {
@@ -145,6 +149,7 @@ namespace MUSIC {
   Setup::fullInit ()
   {
     errorChecks ();
+    configureLog ();
     if (!config ("timebase", &timebase_))
       timebase_ = MUSIC_DEFAULT_TIMEBASE;	       // default timebase
     string binary;
@@ -156,6 +161,23 @@ namespace MUSIC {
   }
 
 
+  // The log level is resolved here, once, rather than at each log
+  // statement
+  void
+  Setup::configureLog ()
+  {
+    std::string level;
+    if (!config ("log_level", &level))
+      return;
+    int rank;
+    if (!config ("log_rank", &rank))
+      rank = -1;
+    std::string fileName;
+    config ("log", &fileName);
+    Log::configure (Log::parseLevel (level), rank, fileName);
+  }
+
+
   Setup::~Setup ()
   {
     for (std::vector<Port*>::iterator i = ports_.begin ();
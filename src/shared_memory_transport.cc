@@ -0,0 +1,347 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <mpi.h>
+
+#include "config.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+extern "C" {
+#include <sched.h>
+}
+
+#include "music/transport.hh"
+#include "music/error.hh"
+
+namespace MUSIC {
+
+  const int CACHE_LINE = 64;
+
+  // The counters of a ring are on separate cache lines since they
+  // are written by different processes
+  struct SharedMemoryTransport::RingHeader {
+    volatile long long written;
+    char pad1[CACHE_LINE - sizeof (long long)];
+    volatile long long read;
+    char pad2[CACHE_LINE - sizeof (long long)];
+  };
+
+
+  SharedMemoryTransport::SharedMemoryTransport (MPI::Intercomm intercomm,
+						bool high,
+						int ringSize)
+    : mpi_ (intercomm),
+      ringSize_ (ringSize),
+      nColocated_ (0),
+      open_ (false),
+      outRings_ (intercomm.Get_remote_size (), static_cast<char*> (NULL)),
+      inRings_ (intercomm.Get_remote_size (), static_cast<char*> (NULL)),
+      unexpected_ (intercomm.Get_remote_size ())
+  {
+#ifdef HAVE_MPI_WIN_ALLOCATE_SHARED
+    // Processes of both applications which share our node
+    MPI::Intracomm merged = intercomm.Merge (high);
+    MPI_Comm_split_type (merged, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL,
+			 &nodeComm_);
+    merged.Free ();
+    int nodeSize;
+    MPI_Comm_size (nodeComm_, &nodeSize);
+    int local[2] = { high, intercomm.Get_rank () };
+    std::vector<int> all (2 * nodeSize);
+    MPI_Allgather (local, 2, MPI_INT, &all[0], 2, MPI_INT, nodeComm_);
+
+    // Co-located remote processes as (remote rank, node rank), and
+    // our index among the co-located processes of our application.
+    // Each receiver has one ring per co-located sender, in order of
+    // rank, so our index is the position of our ring in the windows
+    // of the remote processes.
+    std::vector<std::pair<int, int> > colocated;
+    int index = 0;
+    for (int n = 0; n < nodeSize; ++n)
+      if (all[2 * n] != high)
+	colocated.push_back (std::make_pair (all[2 * n + 1], n));
+      else if (all[2 * n + 1] < intercomm.Get_rank ())
+	++index;
+    std::sort (colocated.begin (), colocated.end ());
+    nColocated_ = colocated.size ();
+
+    int slot = sizeof (RingHeader)
+      + (ringSize_ + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+    MPI_Info info;
+    MPI_Info_create (&info);
+    MPI_Info_set (info,
+		  const_cast<char*> ("alloc_shared_noncontig"),
+		  const_cast<char*> ("true"));
+    char* base;
+    MPI_Win_allocate_shared (nColocated_ * slot, 1, info, nodeComm_,
+			     &base, &window_);
+    MPI_Info_free (&info);
+    MPI_Win_lock_all (MPI_MODE_NOCHECK, window_);
+    open_ = true;
+
+    for (int i = 0; i < nColocated_; ++i)
+      {
+	char* ring = base + i * slot;
+	RingHeader* header = reinterpret_cast<RingHeader*> (ring);
+	header->written = 0;
+	header->read = 0;
+	inRings_[colocated[i].first] = ring;
+
+	MPI_Aint size;
+	int dispUnit;
+	char* remoteBase;
+	MPI_Win_shared_query (window_, colocated[i].second,
+			      &size, &dispUnit, &remoteBase);
+	outRings_[colocated[i].first] = remoteBase + index * slot;
+      }
+
+    // The rings must be initialized before anyone uses them
+    sync ();
+    MPI_Barrier (nodeComm_);
+    sync ();
+#else
+    error ("shared_memory requires an MPI library with MPI-3 shared memory windows");
+#endif
+  }
+
+
+  void
+  SharedMemoryTransport::close ()
+  {
+#ifdef HAVE_MPI_WIN_ALLOCATE_SHARED
+    if (!open_)
+      return;
+    MPI_Win_unlock_all (window_);
+    MPI_Win_free (&window_);
+    MPI_Comm_free (&nodeComm_);
+    open_ = false;
+#endif
+  }
+
+
+  // Memory barrier between our accesses to the window and those of
+  // the other processes
+  void
+  SharedMemoryTransport::sync ()
+  {
+#ifdef HAVE_MPI_WIN_ALLOCATE_SHARED
+    MPI_Win_sync (window_);
+#endif
+  }
+
+
+  // Blocks while the ring is full
+  void
+  SharedMemoryTransport::write (char* ring, const char* data, int size)
+  {
+    RingHeader* header = reinterpret_cast<RingHeader*> (ring);
+    char* buffer = ring + sizeof (RingHeader);
+    long long written = header->written;
+    while (size > 0)
+      {
+	sync ();
+	int room = ringSize_ - (written - header->read);
+	if (room == 0)
+	  {
+	    // Let the receiver run if it shares our processor
+	    sched_yield ();
+	    continue;
+	  }
+	int offset = written % ringSize_;
+	int n = std::min (size, std::min (room, ringSize_ - offset));
+	memcpy (buffer + offset, data, n);
+	// The data must be visible before the counter
+	sync ();
+	written += n;
+	header->written = written;
+	data += n;
+	size -= n;
+      }
+  }
+
+
+  // Blocks until size bytes have been read
+  void
+  SharedMemoryTransport::read (char* ring, char* data, int size)
+  {
+    RingHeader* header = reinterpret_cast<RingHeader*> (ring);
+    char* buffer = ring + sizeof (RingHeader);
+    long long consumed = header->read;
+    while (size > 0)
+      {
+	sync ();
+	int available = header->written - consumed;
+	if (available == 0)
+	  {
+	    sched_yield ();
+	    continue;
+	  }
+	int offset = consumed % ringSize_;
+	int n = std::min (size, std::min (available, ringSize_ - offset));
+	memcpy (data, buffer + offset, n);
+	// We must be done with the data before the sender overwrites it
+	sync ();
+	consumed += n;
+	header->read = consumed;
+	data += n;
+	size -= n;
+      }
+  }
+
+
+  // The header of the next message, without consuming it.  Returns
+  // false if no complete header is available.
+  bool
+  SharedMemoryTransport::peek (char* ring, MessageHeader& message)
+  {
+    RingHeader* header = reinterpret_cast<RingHeader*> (ring);
+    char* buffer = ring + sizeof (RingHeader);
+    sync ();
+    if (header->written - header->read
+	< static_cast<long long> (sizeof (MessageHeader)))
+      return false;
+    int offset = header->read % ringSize_;
+    int n = std::min (static_cast<int> (sizeof (MessageHeader)),
+		      ringSize_ - offset);
+    char* dest = reinterpret_cast<char*> (&message);
+    memcpy (dest, buffer + offset, n);
+    memcpy (dest + n, buffer, sizeof (MessageHeader) - n);
+    return true;
+  }
+
+
+  // Move the message with the given header, which has been consumed,
+  // to the queue of its source
+  void
+  SharedMemoryTransport::moveAside (char* ring,
+				    MessageHeader& message,
+				    int source)
+  {
+    unexpected_[source].push_back (Message ());
+    Message& m = unexpected_[source].back ();
+    m.tag = message.tag;
+    m.data.resize (message.size);
+    if (message.size > 0)
+      read (ring, &m.data[0], message.size);
+  }
+
+
+  void
+  SharedMemoryTransport::send (const void* buffer, int count,
+			       MPI::Datatype type, int dest, int tag)
+  {
+    char* ring = outRings_[dest];
+    if (ring == NULL)
+      {
+	mpi_.send (buffer, count, type, dest, tag);
+	return;
+      }
+    MessageHeader message;
+    message.tag = tag;
+    message.size = count * type.Get_size ();
+    write (ring, reinterpret_cast<char*> (&message), sizeof (message));
+    write (ring, static_cast<const char*> (buffer), message.size);
+  }
+
+
+  int
+  SharedMemoryTransport::receive (void* buffer, int count,
+				  MPI::Datatype type, int source, int tag)
+  {
+    char* ring = inRings_[source];
+    if (ring == NULL)
+      return mpi_.receive (buffer, count, type, source, tag);
+    int maxSize = count * type.Get_size ();
+    std::deque<Message>& queue = unexpected_[source];
+    for (std::deque<Message>::iterator m = queue.begin ();
+	 m != queue.end ();
+	 ++m)
+      if (m->tag == tag)
+	{
+	  int size = m->data.size ();
+	  if (size > maxSize)
+	    error ("internal error: shared memory message truncated");
+	  memcpy (buffer, m->data.data (), size);
+	  queue.erase (m);
+	  return size;
+	}
+    while (true)
+      {
+	MessageHeader message;
+	read (ring, reinterpret_cast<char*> (&message), sizeof (message));
+	if (message.tag != tag)
+	  {
+	    moveAside (ring, message, source);
+	    continue;
+	  }
+	if (message.size > maxSize)
+	  {
+	    std::ostringstream msg;
+	    msg << "internal error: shared memory message of "
+		<< message.size << " bytes truncated to " << maxSize;
+	    error (msg.str ());
+	  }
+	read (ring, static_cast<char*> (buffer), message.size);
+	return message.size;
+      }
+  }
+
+
+  bool
+  SharedMemoryTransport::probe (int source, int tag)
+  {
+    char* ring = inRings_[source];
+    if (ring == NULL)
+      return mpi_.probe (source, tag);
+    std::deque<Message>& queue = unexpected_[source];
+    for (std::deque<Message>::iterator m = queue.begin ();
+	 m != queue.end ();
+	 ++m)
+      if (m->tag == tag)
+	return true;
+    MessageHeader message;
+    while (peek (ring, message))
+      {
+	if (message.tag == tag)
+	  return true;
+	read (ring, reinterpret_cast<char*> (&message), sizeof (message));
+	moveAside (ring, message, source);
+      }
+    // Probes are made in a loop while waiting for data
+    sched_yield ();
+    return false;
+  }
+
+
+  void
+  SharedMemoryTransport::allreduceMax (int*, int*, int)
+  {
+    error ("internal error: collective on an inter transport");
+  }
+
+
+  void
+  SharedMemoryTransport::broadcast (void*, int, MPI::Datatype, int)
+  {
+    error ("internal error: collective on an inter transport");
+  }
+
+}
@@ -136,7 +136,7 @@ namespace MUSIC {
 
   
   SpatialNegotiator::SpatialNegotiator (IndexMap* ind, Index::Type type_)
-    : indices (ind->copy ()), type (type_)
+    : comm (NULL), indices (ind->copy ()), type (type_)
   {
   }
 
@@ -161,31 +161,28 @@ namespace MUSIC {
 	  u = i->end ();
 	w += i->end () - i->begin ();
       }
-    // Now take maximum over all processes
-    std::vector<int> m (nProcesses);
-    comm.Allgather (&u, 1, MPI::INT, &m[0], 1, MPI::INT);
-    for (unsigned int i = 0; i < nProcesses; ++i)
-      if (m[i] > u)
-	u = m[i];
-    width = u;
-    comm.Allgather (&w, 1, MPI::INT, &m[0], 1, MPI::INT);
-    for (unsigned int i = 0; i < nProcesses; ++i)
-      if (m[i] > w)
-	w = m[i];
-    maxLocalWidth_ = w;
+    // Now take maximum over all processes; both values are reduced
+    // in a single collective
+    int local[2] = { u, w };
+    int global[2];
+    comm->allreduceMax (local, global, 2);
+    width = global[0];
+    maxLocalWidth_ = global[1];
   }
 
   
   void
-  SpatialOutputNegotiator::negotiateWidth (MPI::Intercomm intercomm)
+  SpatialOutputNegotiator::negotiateWidth (Transport* intercomm)
   {
     SpatialNegotiator::negotiateWidth ();
     if (localRank == 0)
       {
 	// Receiver might need to know sender width
-	intercomm.Send (&width, 1, MPI::INT, 0, WIDTH_MSG);
 	int remoteWidth;
-	intercomm.Recv (&remoteWidth, 1, MPI::INT, 0, WIDTH_MSG);
+	int tag = portTag (receiverPortCode_, WIDTH_MSG);
+	// The receiver leader receives before it sends
+	intercomm->send (&width, 1, MPI::INT, 0, tag);
+	intercomm->receive (&remoteWidth, 1, MPI::INT, 0, tag);
 	if (remoteWidth != width)
 	  {
 	    std::ostringstream msg;
@@ -198,24 +195,29 @@ namespace MUSIC {
 
   
   void
-  SpatialInputNegotiator::negotiateWidth (MPI::Intercomm intercomm)
+  SpatialInputNegotiator::negotiateWidth (Transport* intercomm)
   {
     SpatialNegotiator::negotiateWidth ();
+    // The reduced width is the same in all processes, so they all
+    // agree on whether a wildcard needs to be resolved
+    bool wildcard = width == Index::WILDCARD_MAX;
     if (localRank == 0)
       {
+	int tag = portTag (receiverPortCode_, WIDTH_MSG);
 	int remoteWidth;
-	intercomm.Recv (&remoteWidth, 1, MPI::INT, 0, WIDTH_MSG);
+	intercomm->receive (&remoteWidth, 1, MPI::INT, 0, tag);
 	// NOTE: For now, the handling of Index::WILDCARD_MAX is a bit
 	// incomplete since, if there is any index interval on the
 	// receiver side with index larger than the sender side width,
 	// we will still choose sender side width as receiver side
 	// width.
-	if (width == Index::WILDCARD_MAX)
+	if (wildcard)
 	  width = remoteWidth;
-	intercomm.Send (&width, 1, MPI::INT, 0, WIDTH_MSG);
+	intercomm->send (&width, 1, MPI::INT, 0, tag);
       }
-    // Broadcast result (if we used a wildcard)
-    comm.Bcast (&width, 1, MPI::INT, 0);
+    // Broadcast result only if we used a wildcard
+    if (wildcard)
+      comm->broadcast (&width, 1, MPI::INT, 0);
     if (maxLocalWidth_ == Index::WILDCARD_MAX)
       maxLocalWidth_ = width;
   }
@@ -435,50 +437,50 @@ namespace MUSIC {
 
 
   void
-  SpatialNegotiator::send (MPI::Comm& comm,
+  SpatialNegotiator::send (Transport* comm,
 			   int destRank,
+			   int tag,
 			   NegotiationIntervals& intervals)
   {
     SpatialNegotiationData* data = &intervals[0];
     int nIntervals = intervals.size ();
     while (nIntervals >= TRANSMITTED_INTERVALS_MAX)
       {
-	comm.Send (data,
-		   sizeof (SpatialNegotiationData) / sizeof (int) * nIntervals,
-		   MPI::INT,
-		   destRank,
-		   SPATIAL_NEGOTIATION_MSG);
+	comm->send (data,
+		    sizeof (SpatialNegotiationData) / sizeof (int)
+		    * TRANSMITTED_INTERVALS_MAX,
+		    MPI::INT,
+		    destRank,
+		    tag);
 	data += TRANSMITTED_INTERVALS_MAX;
 	nIntervals -= TRANSMITTED_INTERVALS_MAX;
       }
-    comm.Send (data,
-	       sizeof (SpatialNegotiationData) / sizeof (int) * nIntervals,
-	       MPI::INT,
-	       destRank,
-	       SPATIAL_NEGOTIATION_MSG);
+    comm->send (data,
+		sizeof (SpatialNegotiationData) / sizeof (int) * nIntervals,
+		MPI::INT,
+		destRank,
+		tag);
   }
 
 
   void
-  SpatialNegotiator::receive (MPI::Comm& comm,
+  SpatialNegotiator::receive (Transport* comm,
 			      int sourceRank,
+			      int tag,
 			      NegotiationIntervals& intervals)
   {
-    MPI::Status status;
     int nReceived;
     int nextPos = 0;
     do
       {
 	intervals.resize (nextPos + TRANSMITTED_INTERVALS_MAX);
-	comm.Recv (&intervals[nextPos],
-		   sizeof (SpatialNegotiationData) / sizeof (int)
-		   * TRANSMITTED_INTERVALS_MAX,
-		   MPI::INT,
-		   sourceRank,
-		   SPATIAL_NEGOTIATION_MSG,
-		   status);
-	nReceived = (status.Get_count (MPI::INT)
-		     / (sizeof (SpatialNegotiationData) / sizeof (int)));
+	int size = comm->receive (&intervals[nextPos],
+				  sizeof (SpatialNegotiationData) / sizeof (int)
+				  * TRANSMITTED_INTERVALS_MAX,
+				  MPI::INT,
+				  sourceRank,
+				  tag);
+	nReceived = size / sizeof (SpatialNegotiationData);
 	nextPos += nReceived;
       }
     while (nReceived == TRANSMITTED_INTERVALS_MAX);
@@ -494,13 +496,13 @@ namespace MUSIC {
       error ("internal error in SpatialNegotiator::allToAll ()");
     in[localRank] = out[localRank];
     for (unsigned int i = 0; i < localRank; ++i)
-      receive (comm, i, in[i]);
+      receive (comm, i, SPATIAL_NEGOTIATION_MSG, in[i]);
     for (unsigned int i = localRank + 1; i < nProcesses; ++i)
-      send (comm, i, out[i]);
+      send (comm, i, SPATIAL_NEGOTIATION_MSG, out[i]);
     for (unsigned int i = 0; i < localRank; ++i)
-      send (comm, i, out[i]);
+      send (comm, i, SPATIAL_NEGOTIATION_MSG, out[i]);
     for (unsigned int i = localRank + 1; i < nProcesses; ++i)
-      receive (comm, i, in[i]);
+      receive (comm, i, SPATIAL_NEGOTIATION_MSG, in[i]);
   }
   
   
@@ -512,9 +514,10 @@ namespace MUSIC {
 
   
   NegotiationIterator
-  SpatialOutputNegotiator::negotiate (MPI::Intracomm c,
-				      MPI::Intercomm intercomm,
+  SpatialOutputNegotiator::negotiate (Transport* c,
+				      Transport* intercomm,
 				      int remoteNProc,
+				      int receiverPortCode,
 				      // only for debugging:
 #ifdef MUSIC_DEBUG
 				      Connector* connector)
@@ -523,8 +526,9 @@ namespace MUSIC {
 #endif
   {
     comm = c;
-    nProcesses = comm.Get_size ();
-    localRank = comm.Get_rank ();
+    nProcesses = comm->size ();
+    localRank = comm->rank ();
+    receiverPortCode_ = receiverPortCode;
     #ifdef MUSIC_DEBUG
     connector_ = connector;
     #endif
@@ -547,8 +551,9 @@ namespace MUSIC {
     allToAll (results, local);
 
     // Receive from remote connector
+    int tag = portTag (receiverPortCode_, SPATIAL_NEGOTIATION_MSG);
     for (int i = 0; i < remoteNProc; ++i)
-      receive (intercomm, i, remote[i]);
+      receive (intercomm, i, tag, remote[i]);
     
     results.resize (remoteNProc);
     // core operation of virtual connector:
@@ -556,7 +561,7 @@ namespace MUSIC {
 
     // Send to remote connector
     for (int i = 0; i < remoteNProc; ++i)
-      send (intercomm, i, results[i]);
+      send (intercomm, i, tag, results[i]);
     
     results.resize (nProcesses);
     intersectToBuffers (remote, local, results);
@@ -576,9 +581,10 @@ namespace MUSIC {
 
   
   NegotiationIterator
-  SpatialInputNegotiator::negotiate (MPI::Intracomm c,
-				     MPI::Intercomm intercomm,
+  SpatialInputNegotiator::negotiate (Transport* c,
+				     Transport* intercomm,
 				     int remoteNProc,
+				     int receiverPortCode,
 				      // only for debugging:
 #ifdef MUSIC_DEBUG
 				     Connector* connector)
@@ -587,8 +593,9 @@ namespace MUSIC {
 #endif
   {
     comm = c;
-    nProcesses = comm.Get_size ();
-    localRank = comm.Get_rank ();
+    nProcesses = comm->size ();
+    localRank = comm->rank ();
+    receiverPortCode_ = receiverPortCode;
     #ifdef MUSIC_DEBUG
     connector_ = connector;
     #endif
@@ -605,11 +612,12 @@ namespace MUSIC {
 
     intersectToBuffers (mappedDist, canonicalDist, remote);
 
+    int tag = portTag (receiverPortCode_, SPATIAL_NEGOTIATION_MSG);
     for (int i = 0; i < remoteNProc; ++i)
-      send (intercomm, i, remote[i]);
+      send (intercomm, i, tag, remote[i]);
     
     for (int i = 0; i < remoteNProc; ++i)
-      receive (intercomm, i, remote[i]);
+      receive (intercomm, i, tag, remote[i]);
     
     return NegotiationIterator (remote);
   }
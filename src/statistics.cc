@@ -0,0 +1,133 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "music/statistics.hh"
+
+namespace MUSIC {
+
+  void
+  StatisticsReport::add (std::string label, double value)
+  {
+    labels_.push_back (label);
+    values_.push_back (value);
+  }
+
+
+  void
+  StatisticsReport::write (std::ostream& out, std::string heading)
+  {
+    int n = values_.size ();
+    if (n == 0)
+      return;
+    std::vector<double> min (n), max (n), sum (n);
+    comm_.Reduce (&values_[0], &min[0], n, MPI::DOUBLE, MPI::MIN, 0);
+    comm_.Reduce (&values_[0], &max[0], n, MPI::DOUBLE, MPI::MAX, 0);
+    comm_.Reduce (&values_[0], &sum[0], n, MPI::DOUBLE, MPI::SUM, 0);
+    if (comm_.Get_rank () != 0)
+      return;
+
+    int size = comm_.Get_size ();
+    out << heading << std::endl;
+    out << std::setw (40) << std::left << ""
+	<< std::right
+	<< std::setw (13) << "min"
+	<< std::setw (13) << "mean"
+	<< std::setw (13) << "max" << std::endl;
+    for (int i = 0; i < n; ++i)
+      out << "  " << std::setw (38) << std::left << labels_[i]
+	  << std::right << std::setprecision (6)
+	  << std::setw (13) << min[i]
+	  << std::setw (13) << sum[i] / size
+	  << std::setw (13) << max[i] << std::endl;
+  }
+
+
+
+  void
+  CommunicationMatrix::add (int remoteWorldRank,
+			    const CommunicationStatistics& stats)
+  {
+    CommunicationStatistics& sum = sent_[remoteWorldRank];
+    sum.messages += stats.messages;
+    sum.bytes += stats.bytes;
+  }
+
+
+  std::vector<std::string>
+  gatherToRoot (const std::string& local)
+  {
+    int worldRank = MPI::COMM_WORLD.Get_rank ();
+    int nProcesses = MPI::COMM_WORLD.Get_size ();
+    int size = local.size ();
+    std::vector<int> sizes (nProcesses);
+    MPI::COMM_WORLD.Gather (&size, 1, MPI::INT, &sizes[0], 1, MPI::INT, 0);
+    std::vector<int> displacements (nProcesses, 0);
+    for (int i = 1; i < nProcesses; ++i)
+      displacements[i] = displacements[i - 1] + sizes[i - 1];
+    std::vector<char> all (worldRank == 0
+			   ? displacements.back () + sizes.back ()
+			   : 0);
+    MPI::COMM_WORLD.Gatherv (local.data (), size, MPI::CHAR,
+			     all.empty () ? NULL : &all[0],
+			     &sizes[0], &displacements[0], MPI::CHAR,
+			     0);
+    std::vector<std::string> strings;
+    if (worldRank != 0)
+      return strings;
+    for (int i = 0; i < nProcesses; ++i)
+      strings.push_back (std::string (all.begin () + displacements[i],
+				      all.begin () + displacements[i]
+				      + sizes[i]));
+    return strings;
+  }
+
+
+  void
+  CommunicationMatrix::write (std::string fileName)
+  {
+    // One line "sender,receiver,messages,bytes" per receiver
+    int worldRank = MPI::COMM_WORLD.Get_rank ();
+    std::ostringstream out;
+    for (std::map<int, CommunicationStatistics>::iterator r = sent_.begin ();
+	 r != sent_.end ();
+	 ++r)
+      out << worldRank << ',' << r->first << ',' << r->second.messages
+	  << ',' << r->second.bytes << std::endl;
+
+    std::vector<std::string> all = gatherToRoot (out.str ());
+    if (worldRank != 0)
+      return;
+
+    std::ofstream file (fileName.c_str ());
+    file << "sender,receiver,messages,bytes" << std::endl;
+    for (std::vector<std::string>::iterator lines = all.begin ();
+	 lines != all.end ();
+	 ++lines)
+      file << *lines;
+    if (!file)
+      std::cerr << "MUSIC: couldn't write communication matrix to "
+		<< fileName << std::endl;
+  }
+
+}
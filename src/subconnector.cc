@@ -21,22 +21,23 @@
 
 #include "music/communication.hh"
 
-#include "music/subconnector.hh"
+#include <algorithm>
+#include <cstring>
 
-#ifdef MUSIC_DEBUG
-#include <cstdlib>
-#endif
+#include "music/subconnector.hh"
+#include "music/trace.hh"
+#include "music/watchdog.hh"
 
 namespace MUSIC {
 
   Subconnector::Subconnector (Synchronizer* synch_,
-			      MPI::Intercomm intercomm_,
+			      Transport* transport_,
 			      int remoteLeader,
 			      int remoteRank,
 			      int receiverRank,
 			      int receiverPortCode)
     : synch (synch_),
-      intercomm (intercomm_),
+      transport (transport_),
       remoteRank_ (remoteRank),
       remoteWorldRank_ (remoteLeader + remoteRank),
       receiverRank_ (receiverRank),
@@ -50,7 +51,7 @@ namespace MUSIC {
   {
   }
 
-  
+
   BufferingOutputSubconnector::BufferingOutputSubconnector (int elementSize)
     : buffer_ (elementSize)
   {
@@ -68,14 +69,19 @@ namespace MUSIC {
    *
    ********************************************************************/
 
+  // A block is sent in chunks of CONT_BUFFER_MAX bytes, the last one
+  // shorter.  An empty first chunk is followed by an int telling
+  // whether the block is empty (0) or the sender has flushed (1), so
+  // the receiver only needs to wait on the data tag of its port.
+
   ContOutputSubconnector::ContOutputSubconnector (Synchronizer* synch_,
-						  MPI::Intercomm intercomm_,
+						  Transport* transport_,
 						  int remoteLeader,
 						  int remoteRank,
 						  int receiverPortCode_,
 						  MPI::Datatype type)
     : Subconnector (synch_,
-		    intercomm_,
+		    transport_,
 		    remoteLeader,
 		    remoteRank,
 		    remoteRank,
@@ -104,6 +110,8 @@ namespace MUSIC {
   void
   ContOutputSubconnector::send ()
   {
+    double start = MPI::Wtime ();
+    Watchdog::beginWait (this);
     void* data;
     int size;
     buffer_.nextBlock (data, size);
@@ -112,20 +120,33 @@ namespace MUSIC {
     while (size >= CONT_BUFFER_MAX)
       {
 	MUSIC_LOGR ("Sending " << CONT_BUFFER_MAX << " bytes to rank " << remoteRank_);
-	intercomm.Send (buffer,
-			CONT_BUFFER_MAX / type_.Get_size (),
-			type_,
-			remoteRank_,
-			CONT_MSG);
+	transport->send (buffer,
+			 CONT_BUFFER_MAX / type_.Get_size (),
+			 type_,
+			 remoteRank_,
+			 tag (CONT_MSG));
+	stats_.message (CONT_BUFFER_MAX);
 	buffer += CONT_BUFFER_MAX;
 	size -= CONT_BUFFER_MAX;
       }
     MUSIC_LOGR ("Last send " << size << " bytes to rank " << remoteRank_);
-    intercomm.Send (buffer,
-		    size / type_.Get_size (),
-		    type_,
-		    remoteRank_,
-		    CONT_MSG);
+    transport->send (buffer,
+		     size / type_.Get_size (),
+		     type_,
+		     remoteRank_,
+		     tag (CONT_MSG));
+    stats_.message (size);
+    if (buffer == data && size == 0)
+      {
+	// An empty block, not a flush
+	int stop = 0;
+	transport->send (&stop, 1, MPI::INT, remoteRank_, tag (CONT_MSG));
+      }
+    Watchdog::endWait ();
+    double end = MPI::Wtime ();
+    stats_.blockedTime += end - start;
+    Trace::transfer ("send", start, end, remoteWorldRank_,
+		     buffer + size - static_cast<char*> (data));
   }
 
   
@@ -143,7 +164,9 @@ namespace MUSIC {
 	else
 	  {
 	    char dummy;
-	    intercomm.Send (&dummy, 0, type_, remoteRank_, FLUSH_MSG);
+	    transport->send (&dummy, 0, type_, remoteRank_, tag (CONT_MSG));
+	    int stop = 1;
+	    transport->send (&stop, 1, MPI::INT, remoteRank_, tag (CONT_MSG));
 	    flushed = true;
 	  }
       }
@@ -151,14 +174,14 @@ namespace MUSIC {
   
 
   ContInputSubconnector::ContInputSubconnector (Synchronizer* synch_,
-						MPI::Intercomm intercomm,
+						Transport* transport,
 						int remoteLeader,
 						int remoteRank,
 						int receiverRank,
 						int receiverPortCode,
 						MPI::Datatype type)
     : Subconnector (synch_,
-		    intercomm,
+		    transport,
 		    remoteLeader,
 		    remoteRank,
 		    receiverRank,
@@ -188,29 +211,45 @@ namespace MUSIC {
   void
   ContInputSubconnector::receive ()
   {
+    double start = MPI::Wtime ();
+    Watchdog::beginWait (this);
+    long long bytes = stats_.bytes;
     char* data;
-    MPI::Status status;
     int size;
+    bool first = true;
     do
       {
 	data = static_cast<char*> (buffer_.insertBlock ());
 	MUSIC_LOGR ("Receiving from rank " << remoteRank_);
-	intercomm.Recv (data,
-			CONT_BUFFER_MAX / type_.Get_size (),
-			type_,
-			remoteRank_,
-			MPI::ANY_TAG,
-			status);
-	if (status.Get_tag () == FLUSH_MSG)
+	size = transport->receive (data,
+				   CONT_BUFFER_MAX / type_.Get_size (),
+				   type_,
+				   remoteRank_,
+				   tag (CONT_MSG));
+	if (first && size == 0)
 	  {
-	    flushed = true;
-	    MUSIC_LOGR ("received flush message");
-	    return;
+	    int stop;
+	    transport->receive (&stop, 1, MPI::INT, remoteRank_,
+				tag (CONT_MSG));
+	    if (stop)
+	      {
+		flushed = true;
+		MUSIC_LOGR ("received flush message");
+		Watchdog::endWait ();
+		stats_.blockedTime += MPI::Wtime () - start;
+		return;
+	      }
 	  }
-	size = status.Get_count (MPI::BYTE);
+	first = false;
+	stats_.message (size);
 	buffer_.trimBlock (size);
       }
     while (size == CONT_BUFFER_MAX);
+    Watchdog::endWait ();
+    double end = MPI::Wtime ();
+    stats_.blockedTime += end - start;
+    Trace::transfer ("receive", start, end, remoteWorldRank_,
+		     stats_.bytes - bytes);
   }
 
 
@@ -227,6 +266,213 @@ namespace MUSIC {
   }
 
   
+  /********************************************************************
+   *
+   * Cont RMA Subconnectors
+   *
+   ********************************************************************/
+
+  ContRMAOutputSubconnector::ContRMAOutputSubconnector (Synchronizer* synch_,
+							Transport* transport_,
+							RMAWindow* window,
+							int remoteLeader,
+							int remoteRank,
+							int receiverPortCode_,
+							MPI::Datatype type)
+    : Subconnector (synch_,
+		    transport_,
+		    remoteLeader,
+		    remoteRank,
+		    remoteRank,
+		    receiverPortCode_),
+      ContOutputSubconnector (synch_,
+			      transport_,
+			      remoteLeader,
+			      remoteRank,
+			      receiverPortCode_,
+			      type),
+      window_ (window)
+  {
+  }
+
+
+  void
+  ContRMAOutputSubconnector::send ()
+  {
+    double start = MPI::Wtime ();
+    Watchdog::beginWait (this);
+    void* data;
+    int size;
+    buffer_.nextBlock (data, size);
+    char* buffer = static_cast <char*> (data);
+    int total = size;
+    do
+      {
+	long long credit[2];
+	transport->receive (credit, 2, MPI::LONG_LONG, remoteRank_,
+			    tag (CONT_MSG));
+	int n = std::min (size, static_cast<int> (credit[1]));
+	MUSIC_LOGR ("Putting " << n << " bytes to rank " << remoteRank_);
+	window_->put (buffer, n, remoteRank_, credit[0]);
+	int notice[2] = { n, size > n };
+	transport->send (notice, 2, MPI::INT, remoteRank_, tag (CONT_MSG));
+	stats_.message (n);
+	buffer += n;
+	size -= n;
+      }
+    while (size > 0);
+    Watchdog::endWait ();
+    double end = MPI::Wtime ();
+    stats_.blockedTime += end - start;
+    Trace::transfer ("send", start, end, remoteWorldRank_, total);
+  }
+
+
+  void
+  ContRMAOutputSubconnector::flush (bool& dataStillFlowing)
+  {
+    if (!flushed)
+      {
+	if (!buffer_.isEmpty ())
+	  {
+	    MUSIC_LOGR ("sending data remaining in buffers");
+	    send ();
+	    dataStillFlowing = true;
+	  }
+	else
+	  {
+	    // The receiver always has a credit posted
+	    long long credit[2];
+	    transport->receive (credit, 2, MPI::LONG_LONG, remoteRank_,
+				tag (CONT_MSG));
+	    int notice[2] = { -1, 0 };
+	    transport->send (notice, 2, MPI::INT, remoteRank_, tag (CONT_MSG));
+	    flushed = true;
+	  }
+      }
+  }
+
+
+  ContRMAInputSubconnector::ContRMAInputSubconnector (Synchronizer* synch_,
+						      Transport* transport,
+						      RMAWindow* window,
+						      int remoteLeader,
+						      int remoteRank,
+						      int receiverRank,
+						      int receiverPortCode,
+						      MPI::Datatype type)
+    : Subconnector (synch_,
+		    transport,
+		    remoteLeader,
+		    remoteRank,
+		    receiverRank,
+		    receiverPortCode),
+      ContInputSubconnector (synch_,
+			     transport,
+			     remoteLeader,
+			     remoteRank,
+			     receiverRank,
+			     receiverPortCode,
+			     type),
+      window_ (window),
+      attached_ (NULL),
+      attachedSize_ (0),
+      creditPosted_ (false)
+  {
+  }
+
+
+  // Offer the space for the next block to the sender.  The BIFO must
+  // not be changed, other than by reading, until the notice arrives.
+  void
+  ContRMAInputSubconnector::postCredit ()
+  {
+    void* block = buffer_.insertBlock ();
+    // insertBlock () may have moved or grown the buffer
+    if (buffer_.storage () != attached_
+	|| buffer_.capacity () != attachedSize_)
+      {
+	if (attached_ != NULL)
+	  window_->detach (attached_);
+	attached_ = buffer_.storage ();
+	attachedSize_ = buffer_.capacity ();
+	window_->attach (attached_, attachedSize_);
+      }
+    long long credit[2] = { window_->address (block),
+			    buffer_.maxBlockSize () };
+    transport->send (credit, 2, MPI::LONG_LONG, remoteRank_, tag (CONT_MSG));
+    creditPosted_ = true;
+  }
+
+
+  void
+  ContRMAInputSubconnector::initialCommunication ()
+  {
+    receive ();
+    buffer_.fill (synch->initialBufferedTicks ());
+    if (!flushed)
+      postCredit ();
+  }
+
+
+  void
+  ContRMAInputSubconnector::maybeCommunicate ()
+  {
+    if (!flushed && synch->communicate ())
+      {
+	receive ();
+	if (!flushed)
+	  postCredit ();
+      }
+  }
+
+
+  void
+  ContRMAInputSubconnector::receive ()
+  {
+    double start = MPI::Wtime ();
+    Watchdog::beginWait (this);
+    long long bytes = stats_.bytes;
+    int notice[2];
+    do
+      {
+	if (!creditPosted_)
+	  postCredit ();
+	transport->receive (notice, 2, MPI::INT, remoteRank_, tag (CONT_MSG));
+	creditPosted_ = false;
+	if (notice[0] < 0)
+	  {
+	    flushed = true;
+	    MUSIC_LOGR ("received flush notice");
+	    break;
+	  }
+	window_->sync ();
+	stats_.message (notice[0]);
+	buffer_.trimBlock (notice[0]);
+      }
+    while (notice[1]);
+    Watchdog::endWait ();
+    double end = MPI::Wtime ();
+    stats_.blockedTime += end - start;
+    if (!flushed)
+      Trace::transfer ("receive", start, end, remoteWorldRank_,
+		       stats_.bytes - bytes);
+  }
+
+
+  void
+  ContRMAInputSubconnector::flush (bool& dataStillFlowing)
+  {
+    if (!flushed)
+      {
+	MUSIC_LOGR ("receiving and throwing away data");
+	receive ();
+	if (!flushed)
+	  dataStillFlowing = true;
+      }
+  }
+
+
   /********************************************************************
    *
    * Event Subconnectors
@@ -235,17 +481,19 @@ namespace MUSIC {
 
 
   EventOutputSubconnector::EventOutputSubconnector (Synchronizer* synch_,
-						    MPI::Intercomm intercomm,
+						    Transport* transport,
 						    int remoteLeader,
 						    int remoteRank,
-						    int receiverPortCode)
+						    int receiverPortCode,
+						    AdaptiveBuffering* adaptive)
     : Subconnector (synch_,
-		    intercomm,
+		    transport,
 		    remoteLeader,
 		    remoteRank,
 		    remoteRank,
 		    receiverPortCode),
-      BufferingOutputSubconnector (sizeof (Event))
+      BufferingOutputSubconnector (sizeof (Event)),
+      adaptive_ (adaptive)
   {
   }
   
@@ -266,22 +514,49 @@ namespace MUSIC {
   EventOutputSubconnector::send ()
   {
     MUSIC_LOGRE ("send");
+    bool adaptive = synch->adaptiveInterval () > 0;
+    if (adaptive && adaptive_->announce ())
+      {
+	Event* e = static_cast<Event*> (buffer_.insert ());
+	e->id = BUFFERING_MARK;
+	e->t = synch->allowedBuffered ();
+      }
+    double start = MPI::Wtime ();
+    Watchdog::beginWait (this);
     void* data;
     int size;
     buffer_.nextBlock (data, size);
+    int totalSize = size;
+    // Count the events without the flush and buffering marks, as the
+    // receiver does
+    Event* ev = static_cast<Event*> (data);
+    int nEvents = totalSize / sizeof (Event);
+    if (nEvents > 0 && ev[nEvents - 1].id == BUFFERING_MARK)
+      --nEvents;
+    if (nEvents > 0 && ev[0].id == FLUSH_MARK)
+      --nEvents;
     // NOTE: marshalling
     char* buffer = static_cast <char*> (data);
     while (size >= SPIKE_BUFFER_MAX)
       {
-	intercomm.Send (buffer,
-			SPIKE_BUFFER_MAX,
-			MPI::BYTE,
-			remoteRank_,
-			SPIKE_MSG);
+	transport->send (buffer,
+			 SPIKE_BUFFER_MAX,
+			 MPI::BYTE,
+			 remoteRank_,
+			 tag (SPIKE_MSG));
+	stats_.message (SPIKE_BUFFER_MAX);
 	buffer += SPIKE_BUFFER_MAX;
 	size -= SPIKE_BUFFER_MAX;
       }
-    intercomm.Send (buffer, size, MPI::BYTE, remoteRank_, SPIKE_MSG);
+    transport->send (buffer, size, MPI::BYTE, remoteRank_, tag (SPIKE_MSG));
+    stats_.message (size);
+    stats_.events += nEvents;
+    Watchdog::endWait ();
+    double end = MPI::Wtime ();
+    stats_.blockedTime += end - start;
+    Trace::transfer ("send", start, end, remoteWorldRank_, totalSize);
+    if (adaptive)
+      adaptive_->recordSend (totalSize, end - start);
   }
 
   
@@ -308,13 +583,13 @@ namespace MUSIC {
   
 
   EventInputSubconnector::EventInputSubconnector (Synchronizer* synch_,
-						  MPI::Intercomm intercomm,
+						  Transport* transport,
 						  int remoteLeader,
 						  int remoteRank,
 						  int receiverRank,
 						  int receiverPortCode)
     : Subconnector (synch_,
-		    intercomm,
+		    transport,
 		    remoteLeader,
 		    remoteRank,
 		    receiverRank,
@@ -326,20 +601,20 @@ namespace MUSIC {
 
   EventInputSubconnectorGlobal::EventInputSubconnectorGlobal
   (Synchronizer* synch_,
-   MPI::Intercomm intercomm,
+   Transport* transport,
    int remoteLeader,
    int remoteRank,
    int receiverRank,
    int receiverPortCode,
    EventHandlerGlobalIndex* eh)
     : Subconnector (synch_,
-		    intercomm,
+		    transport,
 		    remoteLeader,
 		    remoteRank,
 		    receiverRank,
 		    receiverPortCode),
       EventInputSubconnector (synch_,
-			      intercomm,
+			      transport,
 			      remoteLeader,
 			      remoteRank,
 			      receiverRank,
@@ -355,20 +630,20 @@ namespace MUSIC {
   
   EventInputSubconnectorLocal::EventInputSubconnectorLocal
   (Synchronizer* synch_,
-   MPI::Intercomm intercomm,
+   Transport* transport,
    int remoteLeader,
    int remoteRank,
    int receiverRank,
    int receiverPortCode,
    EventHandlerLocalIndex* eh)
     : Subconnector (synch_,
-		    intercomm,
+		    transport,
 		    remoteLeader,
 		    remoteRank,
 		    receiverRank,
 		    receiverPortCode),
       EventInputSubconnector (synch_,
-			      intercomm,
+			      transport,
 			      remoteLeader,
 			      remoteRank,
 			      receiverRank,
@@ -395,18 +670,22 @@ namespace MUSIC {
   EventInputSubconnectorGlobal::receive ()
   {
     char data[SPIKE_BUFFER_MAX]; 
-    MPI::Status status;
     int size;
     do
       {
-	intercomm.Recv (data,
-			SPIKE_BUFFER_MAX,
-			MPI::BYTE,
-			remoteRank_,
-			SPIKE_MSG,
-			status);
+	double start = MPI::Wtime ();
+	Watchdog::beginWait (this);
+	size = transport->receive (data,
+				   SPIKE_BUFFER_MAX,
+				   MPI::BYTE,
+				   remoteRank_,
+				   tag (SPIKE_MSG));
+	Watchdog::endWait ();
+	double end = MPI::Wtime ();
+	stats_.blockedTime += end - start;
 	Event* ev = (Event*) data;
-	size = status.Get_count (MPI::BYTE);
+	stats_.message (size);
+	Trace::transfer ("receive", start, end, remoteWorldRank_, size);
 	if (size > 0 && ev[0].id == FLUSH_MARK)
 	  {
 	    flushed = true;
@@ -414,6 +693,9 @@ namespace MUSIC {
 	    return;
 	  }
 	int nEvents = size / sizeof (Event);
+	if (nEvents > 0 && ev[nEvents - 1].id == BUFFERING_MARK)
+	  synch->adaptMaxBuffered (static_cast<int> (ev[--nEvents].t));
+	stats_.events += nEvents;
 	//MUSIC_LOGR ("received " << nEvents << "events");
 	for (int i = 0; i < nEvents; ++i)
 	  (*handleEvent) (ev[i].t, ev[i].id);
@@ -427,24 +709,31 @@ namespace MUSIC {
   {
     MUSIC_LOGRE ("receive");
     char data[SPIKE_BUFFER_MAX]; 
-    MPI::Status status;
     int size;
     do
       {
-	intercomm.Recv (data,
-			SPIKE_BUFFER_MAX,
-			MPI::BYTE,
-			remoteRank_,
-			SPIKE_MSG,
-			status);
+	double start = MPI::Wtime ();
+	Watchdog::beginWait (this);
+	size = transport->receive (data,
+				   SPIKE_BUFFER_MAX,
+				   MPI::BYTE,
+				   remoteRank_,
+				   tag (SPIKE_MSG));
+	Watchdog::endWait ();
+	double end = MPI::Wtime ();
+	stats_.blockedTime += end - start;
 	Event* ev = (Event*) data;
-	size = status.Get_count (MPI::BYTE);
+	stats_.message (size);
+	Trace::transfer ("receive", start, end, remoteWorldRank_, size);
 	if (size > 0 && ev[0].id == FLUSH_MARK)
 	  {
 	    flushed = true;
 	    return;
 	  }
 	int nEvents = size / sizeof (Event);
+	if (nEvents > 0 && ev[nEvents - 1].id == BUFFERING_MARK)
+	  synch->adaptMaxBuffered (static_cast<int> (ev[--nEvents].t));
+	stats_.events += nEvents;
 	for (int i = 0; i < nEvents; ++i)
 	  (*handleEvent) (ev[i].t, ev[i].id);
       }
@@ -480,6 +769,173 @@ namespace MUSIC {
     EventInputSubconnector::flush (dataStillFlowing);
   }
   
+  AggregatedEventOutputSubconnector::AggregatedEventOutputSubconnector
+  (Synchronizer* synch_,
+   Transport* transport,
+   EventOutputAggregator* aggregator,
+   int remoteLeader,
+   int remoteRank,
+   int receiverPortCode)
+    : Subconnector (synch_,
+		    transport,
+		    remoteLeader,
+		    remoteRank,
+		    remoteRank,
+		    receiverPortCode),
+      aggregator_ (aggregator)
+  {
+  }
+
+
+  void
+  AggregatedEventOutputSubconnector::maybeCommunicate ()
+  {
+    if (synch->communicate ())
+      {
+	std::vector<char>& packet = aggregator_->packet (remoteRank_);
+	stats_.events += EventAggregator::nEvents (packet);
+	send (packet);
+	packet.clear ();
+      }
+  }
+
+
+  void
+  AggregatedEventOutputSubconnector::send (std::vector<char>& packet)
+  {
+    double start = MPI::Wtime ();
+    Watchdog::beginWait (this);
+    char* buffer = packet.empty () ? NULL : &packet[0];
+    int size = packet.size ();
+    while (size >= SPIKE_BUFFER_MAX)
+      {
+	transport->send (buffer,
+			 SPIKE_BUFFER_MAX,
+			 MPI::BYTE,
+			 remoteRank_,
+			 tag (SPIKE_MSG));
+	stats_.message (SPIKE_BUFFER_MAX);
+	buffer += SPIKE_BUFFER_MAX;
+	size -= SPIKE_BUFFER_MAX;
+      }
+    transport->send (buffer, size, MPI::BYTE, remoteRank_, tag (SPIKE_MSG));
+    stats_.message (size);
+    Watchdog::endWait ();
+    double end = MPI::Wtime ();
+    stats_.blockedTime += end - start;
+    Trace::transfer ("send", start, end, remoteWorldRank_, packet.size ());
+  }
+
+
+  // The packet holds the events gathered by
+  // EventOutputConnector::finalize ()
+  void
+  AggregatedEventOutputSubconnector::flush (bool& dataStillFlowing)
+  {
+    if (!flushed)
+      {
+	std::vector<char>& packet = aggregator_->packet (remoteRank_);
+	if (!packet.empty ())
+	  {
+	    MUSIC_LOGR ("sending data remaining in buffers");
+	    stats_.events += EventAggregator::nEvents (packet);
+	    send (packet);
+	    packet.clear ();
+	    dataStillFlowing = true;
+	    return;
+	  }
+	EventAggregator::Header header;
+	header.rank = EventAggregator::FLUSH_MARK;
+	header.size = 0;
+	transport->send (&header, sizeof (header), MPI::BYTE, remoteRank_,
+			 tag (SPIKE_MSG));
+	stats_.message (sizeof (header));
+	flushed = true;
+      }
+  }
+
+
+  AggregatedEventInputSubconnector::AggregatedEventInputSubconnector
+  (Synchronizer* synch_,
+   Transport* transport,
+   EventInputAggregator* aggregator,
+   int remoteLeader,
+   int remoteRank,
+   int receiverRank,
+   int receiverPortCode)
+    : Subconnector (synch_,
+		    transport,
+		    remoteLeader,
+		    remoteRank,
+		    receiverRank,
+		    receiverPortCode),
+      InputSubconnector (),
+      aggregator_ (aggregator)
+  {
+  }
+
+
+  void
+  AggregatedEventInputSubconnector::maybeCommunicate ()
+  {
+    if (!flushed && synch->communicate ())
+      receive (true);
+  }
+
+
+  void
+  AggregatedEventInputSubconnector::receive (bool deliver)
+  {
+    char data[SPIKE_BUFFER_MAX];
+    std::vector<char> packet;
+    int size;
+    do
+      {
+	double start = MPI::Wtime ();
+	Watchdog::beginWait (this);
+	size = transport->receive (data,
+				   SPIKE_BUFFER_MAX,
+				   MPI::BYTE,
+				   remoteRank_,
+				   tag (SPIKE_MSG));
+	Watchdog::endWait ();
+	double end = MPI::Wtime ();
+	stats_.blockedTime += end - start;
+	stats_.message (size);
+	Trace::transfer ("receive", start, end, remoteWorldRank_, size);
+	packet.insert (packet.end (), data, data + size);
+      }
+    while (size == SPIKE_BUFFER_MAX);
+    EventAggregator::Header header;
+    if (packet.size () >= sizeof (header))
+      {
+	memcpy (&header, &packet[0], sizeof (header));
+	if (header.rank == EventAggregator::FLUSH_MARK)
+	  {
+	    flushed = true;
+	    return;
+	  }
+      }
+    stats_.events += EventAggregator::nEvents (packet);
+    // The events are delivered by the connector after the
+    // communication
+    if (deliver)
+      aggregator_->sort (packet);
+  }
+
+
+  void
+  AggregatedEventInputSubconnector::flush (bool& dataStillFlowing)
+  {
+    if (!flushed)
+      {
+	MUSIC_LOGRE ("receiving and throwing away data");
+	receive (false);
+	if (!flushed)
+	  dataStillFlowing = true;
+      }
+  }
+
   /********************************************************************
    *
    * Message Subconnectors
@@ -487,13 +943,13 @@ namespace MUSIC {
    ********************************************************************/
 
   MessageOutputSubconnector::MessageOutputSubconnector (Synchronizer* synch_,
-							MPI::Intercomm intercomm,
+							Transport* transport,
 							int remoteLeader,
 							int remoteRank,
 							int receiverPortCode,
 							FIBO* buffer)
     : Subconnector (synch_,
-		    intercomm,
+		    transport,
 		    remoteLeader,
 		    remoteRank,
 		    remoteRank,
@@ -514,6 +970,8 @@ namespace MUSIC {
   void
   MessageOutputSubconnector::send ()
   {
+    double start = MPI::Wtime ();
+    Watchdog::beginWait (this);
     void* data;
     int size;
     buffer_->nextBlockNoClear (data, size);
@@ -521,15 +979,23 @@ namespace MUSIC {
     char* buffer = static_cast <char*> (data);
     while (size >= MESSAGE_BUFFER_MAX)
       {
-	intercomm.Send (buffer,
-			MESSAGE_BUFFER_MAX,
-			MPI::BYTE,
-			remoteRank_,
-			MESSAGE_MSG);
+	transport->send (buffer,
+			 MESSAGE_BUFFER_MAX,
+			 MPI::BYTE,
+			 remoteRank_,
+			 tag (MESSAGE_MSG));
+	stats_.message (MESSAGE_BUFFER_MAX);
 	buffer += MESSAGE_BUFFER_MAX;
 	size -= MESSAGE_BUFFER_MAX;
       }
-    intercomm.Send (buffer, size, MPI::BYTE, remoteRank_, MESSAGE_MSG);
+    transport->send (buffer, size, MPI::BYTE, remoteRank_,
+		     tag (MESSAGE_MSG));
+    stats_.message (size);
+    Watchdog::endWait ();
+    double end = MPI::Wtime ();
+    stats_.blockedTime += end - start;
+    Trace::transfer ("send", start, end, remoteWorldRank_,
+		     buffer + size - static_cast<char*> (data));
   }
 
   
@@ -546,8 +1012,10 @@ namespace MUSIC {
 	  }
 	else
 	  {
-	    char dummy;
-	    intercomm.Send (&dummy, 0, MPI::BYTE, remoteRank_, FLUSH_MSG);	
+	    // A lone header of negative size marks the flush
+	    MessageHeader header (0.0, -1);
+	    transport->send (&header, sizeof (header), MPI::BYTE, remoteRank_,
+			     tag (MESSAGE_MSG));
 	    flushed = true;
 	  }
       }
@@ -555,14 +1023,14 @@ namespace MUSIC {
   
 
   MessageInputSubconnector::MessageInputSubconnector (Synchronizer* synch_,
-						      MPI::Intercomm intercomm,
+						      Transport* transport,
 						      int remoteLeader,
 						      int remoteRank,
 						      int receiverRank,
 						      int receiverPortCode,
 						      MessageHandler* mh)
     : Subconnector (synch_,
-		    intercomm,
+		    transport,
 		    remoteLeader,
 		    remoteRank,
 		    receiverRank,
@@ -588,23 +1056,30 @@ namespace MUSIC {
   MessageInputSubconnector::receive ()
   {
     char data[MESSAGE_BUFFER_MAX]; 
-    MPI::Status status;
     int size;
     do
       {
-	intercomm.Recv (data,
-			MESSAGE_BUFFER_MAX,
-			MPI::BYTE,
-			remoteRank_,
-			MPI::ANY_TAG,
-			status);
-	if (status.Get_tag () == FLUSH_MSG)
+	double start = MPI::Wtime ();
+	Watchdog::beginWait (this);
+	size = transport->receive (data,
+				   MESSAGE_BUFFER_MAX,
+				   MPI::BYTE,
+				   remoteRank_,
+				   tag (MESSAGE_MSG));
+	Watchdog::endWait ();
+	double end = MPI::Wtime ();
+	stats_.blockedTime += end - start;
+	MessageHeader* marker
+	  = static_cast<MessageHeader*> (static_cast<void*> (data));
+	if (size == static_cast<int> (sizeof (MessageHeader))
+	    && marker->size () < 0)
 	  {
 	    flushed = true;
 	    MUSIC_LOGRE ("received flush message");
 	    return;
 	  }
-	size = status.Get_count (MPI::BYTE);
+	stats_.message (size);
+	Trace::transfer ("receive", start, end, remoteWorldRank_, size);
 	int current = 0;
 	while (current < size)
 	  {
@@ -24,10 +24,6 @@
 #include "music/synchronizer.hh"
 #include <iostream>
 
-#ifdef MUSIC_DEBUG
-#include <cstdlib>
-#endif
-
 namespace MUSIC {
 
   // This is the algorithm updating the communication schedule
@@ -95,10 +91,25 @@ namespace MUSIC {
   Synchronizer::setMaxBuffered (int m)
   {
     maxBuffered_ = m;
+    bufferLimit_ = m;
     MUSIC_LOGRE ("maxBuffered_ := " << m);
   }
 
 
+  // Both peers must make the same change before the same call of
+  // nextCommunication
+  void
+  Synchronizer::adaptMaxBuffered (int m)
+  {
+    if (m > bufferLimit_)
+      m = bufferLimit_;
+    if (m < 1 && bufferLimit_ >= 1)
+      m = 1;
+    maxBuffered_ = m;
+    MUSIC_LOGRE ("maxBuffered_ := " << m << " (adaptive)");
+  }
+
+
   void
   Synchronizer::setAccLatency (ClockState l)
   {
@@ -117,6 +128,10 @@ namespace MUSIC {
   void
   Synchronizer::initialize ()
   {
+    // Adaptive buffering starts small and grows with the
+    // renegotiations
+    if (adaptiveInterval_ > 0 && bufferLimit_ > 1)
+      maxBuffered_ = 1;
     nextCommunication ();
   }
 
@@ -19,14 +19,18 @@
 //#define MUSIC_DEBUG 1
 #include "music/debug.hh" // Must be included first on BG/L
 
+#include <cstring>
+#include <climits>
+
 #include "music/setup.hh"
 #include "music/temporal.hh"
+#include "music/loop_analysis.hh"
 #include "music/error.hh"
 
 namespace MUSIC {
 
   TemporalNegotiator::TemporalNegotiator (Setup* setup)
-    : setup_ (setup)
+    : setup_ (setup), negotiationBuffer (0)
   {
   }
 
@@ -39,8 +43,11 @@ namespace MUSIC {
     if (negotiationComm != MPI::COMM_NULL)
       negotiationComm.Free ();
     
-    applicationLeaders.Free ();
-    groupWorld.Free ();
+    // The groups are not created if negotiation results were restored
+    if (applicationLeaders != MPI::GROUP_NULL)
+      applicationLeaders.Free ();
+    if (groupWorld != MPI::GROUP_NULL)
+      groupWorld.Free ();
   }
 
 
@@ -130,7 +137,8 @@ namespace MUSIC {
   TemporalNegotiator::computeDefaultMaxBuffered (int maxLocalWidth,
 						 int eventSize,
 						 ClockState tickInterval,
-						 double timebase)
+						 double timebase,
+						 double eventRate)
   {
     int res;
 
@@ -146,10 +154,13 @@ namespace MUSIC {
       // message data
       res = DEFAULT_MESSAGE_MAX_BUFFERED;
     else
-      // event data
-      res = (DEFAULT_PACKET_SIZE
-	     / (EVENT_FREQUENCY_ESTIMATE
-		* maxLocalWidth * eventSize * timebase * tickInterval));
+      {
+	// event data
+	double ticks = (DEFAULT_PACKET_SIZE
+			/ (eventRate
+			   * maxLocalWidth * eventSize * timebase * tickInterval));
+	res = ticks < INT_MAX ? static_cast<int> (ticks) : INT_MAX;
+      }
     if (res < 1)
       res = 1;
     return res;
@@ -170,6 +181,21 @@ namespace MUSIC {
     negotiationData->tickInterval = ti;
     negotiationData->nOutConnections = outputConnections.size ();
     negotiationData->nInConnections = inputConnections.size ();
+
+    // Expected rate of events per index, used for the default
+    // buffering of event ports
+    double eventRate;
+    if (!setup_->config ("rate_hint", &eventRate))
+      eventRate = EVENT_FREQUENCY_ESTIMATE;
+    else if (eventRate <= 0.0)
+      error ("rate_hint must be positive");
+
+    // Adaptive buffering is chosen by the sender application and
+    // applies to event ports
+    int adaptiveInterval;
+    if (!setup_->config ("adaptive_buffering", &adaptiveInterval)
+	|| adaptiveInterval < 0)
+      adaptiveInterval = 0;
     
     for (int i = 0; i < nOut; ++i)
       {
@@ -184,7 +210,10 @@ namespace MUSIC {
 	  = computeDefaultMaxBuffered (connector->maxLocalWidth (),
 				       outputConnections[i].elementSize (),
 				       ti,
-				       setup_->timebase ());
+				       setup_->timebase (),
+				       eventRate);
+	negotiationData->connection[i].adaptiveInterval
+	  = outputConnections[i].elementSize () > 1 ? adaptiveInterval : 0;
 	negotiationData->connection[i].accLatency = 0;
       }
 
@@ -197,6 +226,7 @@ namespace MUSIC {
 	negotiationData->connection[nOut + i].maxBuffered
 	  = inputConnections[i].maxBuffered ();
 	negotiationData->connection[nOut + i].defaultMaxBuffered = 0;
+	negotiationData->connection[nOut + i].adaptiveInterval = 0;
 	negotiationData->connection[nOut + i].accLatency
 	  = inputConnections[i].accLatency ();
 	MUSIC_LOGR ("port " << inputConnections[i].connector ()->receiverPortName () << ": " << inputConnections[i].accLatency ());
@@ -206,45 +236,88 @@ namespace MUSIC {
   }
 
 
+  bool
+  TemporalNegotiator::isSolver ()
+  {
+    return negotiationComm.Get_rank () == SOLVER_RANK;
+  }
+
+
+  /*
+   * Collect the negotiation data of all applications in the solver.
+   * The other application leaders only send their own data.
+   */
+
   void
-  TemporalNegotiator::communicateNegotiationData ()
+  TemporalNegotiator::gatherNegotiationData ()
   {
-    // First talk to others about how many connections each node has
-    int* nConnections = new int[nApplications];
-    negotiationComm.Allgather (&nLocalConnections, 1, MPI::INT,
-			       nConnections, 1, MPI::INT);
+    // First tell the solver how many connections each node has
+    int* nConnections = 0;
+    if (isSolver ())
+      nConnections = new int[nApplications];
+    negotiationComm.Gather (&nLocalConnections, 1, MPI::INT,
+			    nConnections, 1, MPI::INT, SOLVER_RANK);
+
+    int sendSize = negotiationDataSize (nLocalConnections);
+    if (!isSolver ())
+      {
+	negotiationComm.Gatherv (negotiationData, sendSize, MPI::BYTE,
+				 0, 0, 0, MPI::BYTE, SOLVER_RANK);
+	// Results will be received into our own block
+	negotiationBuffer = negotiationData;
+	return;
+      }
+
     int nAllConnections = 0;
     for (int i = 0; i < nApplications; ++i)
       nAllConnections += nConnections[i];
     negotiationBuffer = allocNegotiationData (nApplications, nAllConnections);
 
     char* memory = static_cast<char*> (static_cast<void*> (negotiationBuffer));
-    int* receiveSizes = new int[nApplications];
-    int* displacements = new int[nApplications];
+    blockSizes.resize (nApplications);
+    blockDisplacements.resize (nApplications);
     int displacement = 0;
     for (int i = 0; i < nApplications; ++i)
       {
-	int receiveSize = negotiationDataSize (nConnections[i]);
-	receiveSizes[i] = receiveSize;
-	displacements[i] = displacement;
+	int blockSize = negotiationDataSize (nConnections[i]);
+	blockSizes[i] = blockSize;
+	blockDisplacements[i] = displacement;
 	TemporalNegotiationData* data =
 	  static_cast<TemporalNegotiationData*>
 	  (static_cast<void*> (memory + displacement));
 	nodes.push_back (ApplicationNode (this, i, data));
-	displacement += receiveSize;
+	displacement += blockSize;
       }
     delete[] nConnections;
-    int sendSize = negotiationDataSize (nLocalConnections);
-    negotiationComm.Allgatherv (negotiationData, sendSize, MPI::BYTE,
-				negotiationBuffer, receiveSizes, displacements,
-				MPI::BYTE);
-    delete[] displacements;
-    delete[] receiveSizes;
+    negotiationComm.Gatherv (negotiationData, sendSize, MPI::BYTE,
+			     negotiationBuffer, &blockSizes[0],
+			     &blockDisplacements[0], MPI::BYTE, SOLVER_RANK);
     freeNegotiationData (negotiationData);
     negotiationData = nodes[localNode].data;
   }
 
 
+  /*
+   * Return to each application leader only the ConnectionDescriptors
+   * of its own application
+   */
+
+  void
+  TemporalNegotiator::scatterNegotiationData ()
+  {
+    int receiveSize = negotiationDataSize (nLocalConnections);
+    if (isSolver ())
+      negotiationComm.Scatterv (negotiationBuffer, &blockSizes[0],
+				&blockDisplacements[0], MPI::BYTE,
+				MPI::IN_PLACE, receiveSize, MPI::BYTE,
+				SOLVER_RANK);
+    else
+      negotiationComm.Scatterv (0, 0, 0, MPI::BYTE,
+				negotiationData, receiveSize, MPI::BYTE,
+				SOLVER_RANK);
+  }
+
+
   ConnectionDescriptor*
   TemporalNegotiator::findInputConnection (int node, int port)
   {
@@ -304,6 +377,9 @@ namespace MUSIC {
 
 	    // interpolate
 	    out->interpolate = in->interpolate;
+
+	    // adaptive buffering
+	    in->adaptiveInterval = out->adaptiveInterval;
 	  
 	    // remoteTickInterval
 	    out->remoteTickInterval = nodes[i].data->tickInterval;
@@ -333,76 +409,39 @@ namespace MUSIC {
 
 
   void
-  TemporalNegotiator::depthFirst (ApplicationNode& x,
-				  std::vector<ConnectionEdge>& path)
+  TemporalNegotiator::loopAlgorithm ()
   {
-    if (x.inPath)
-      {
-	// Search path to detect beginning of loop
-	int loop;
-	for (loop = 0; &path[loop].pre () != &x; ++loop)
-	  ;
-
-	// Compute how much headroom we have for buffering
-	ClockState totalDelay = 0;
-	for (unsigned int c = loop; c < path.size (); ++c)
-	  {
-	    MUSIC_LOGR ("latency = " << path[c].latency () << ", ti = "
-			<< path[c].pre ().tickInterval ());
-	    totalDelay += path[c].latency () - path[c].pre ().tickInterval ();
-	  }
-
-	// If negative we will not be able to make it in time
-        // around the loop even without any extra buffering
-        if (totalDelay < 0)
-	  {
-	    std::ostringstream ostr;
-            ostr << "too short latency (" << - timebase * totalDelay
-		 << " s) around loop: " << path[loop].pre ().name ();
-	    for (unsigned int c = loop + 1; c < path.size (); ++c)
-	      ostr << ", " << path[c].pre ().name ();
-	    error0 (ostr.str ());
-	  }
-
-        // Distribute totalDelay as allowed buffering uniformly over loop
-        // (we could do better by considering constraints form other loops)
-	int loopLength = path.size () - loop;
-        ClockState bufDelay = totalDelay / loopLength;
-        for (unsigned int c = 0; c < path.size (); ++c)
-	  {
-	    int allowedTicks = bufDelay / path[c].pre ().tickInterval ();
-	    path[c].setAllowedBuffer (std::min (path[c].allowedBuffer (),
-						allowedTicks));
-	  }
+    LoopAnalysis loops (nApplications);
+    for (int o = 0; o < nApplications; ++o)
+      loops.setTickInterval (o, nodes[o].tickInterval ());
 
-        return;
+    std::vector<ConnectionDescriptor*> edges;
+    for (int o = 0; o < nApplications; ++o)
+      for (int c = 0; c < nodes[o].nConnections (); ++c)
+	{
+	  ConnectionDescriptor* out = &nodes[o].data->connection[c];
+	  loops.addEdge (o, out->remoteNode, out->accLatency, out->maxBuffered);
+	  edges.push_back (out);
+	}
+
+    if (!loops.solve ())
+      {
+	std::vector<int>& loop = loops.shortLoop ();
+	std::ostringstream ostr;
+	ostr << "too short latency ("
+	     << - nodes[0].data->timebase * loops.shortLoopDelay ()
+	     << " s) around loop: " << nodes[loop[0]].name ();
+	for (unsigned int i = 1; i < loop.size (); ++i)
+	  ostr << ", " << nodes[loop[i]].name ();
+	error0 (ostr.str ());
       }
 
-    // Mark as processed (remove from main loop forest)
-    x.visited = true;
-    x.inPath = true;
-
-    // Recurse in depth-first order
-    for (int c = 0; c < x.nConnections (); ++c)
+    for (unsigned int e = 0; e < edges.size (); ++e)
       {
-	path.push_back (x.connection (c));
-	depthFirst (x.connection (c).post (), path);
-	path.pop_back ();
+	MUSIC_LOGR ("latency = " << edges[e]->accLatency
+		    << ", allowed buffer = " << loops.allowedBuffer (e));
+	edges[e]->maxBuffered = loops.allowedBuffer (e);
       }
-
-    x.inPath = false;
-  }
-  
-  
-  void
-  TemporalNegotiator::loopAlgorithm ()
-  {
-    std::vector<ConnectionEdge> path;
-    for (std::vector<ApplicationNode>::iterator node = nodes.begin ();
-	 node != nodes.end ();
-	 ++node)
-      if (!node->visited)
-	depthFirst (*node, path);
   }
 
   
@@ -452,6 +491,8 @@ namespace MUSIC {
 	synch->setMaxBuffered (maxBuffered);
 	synch->setAccLatency (accLatency);
 	synch->setInterpolate (interpolate);
+	synch->setAdaptiveInterval
+	  (negotiationData->connection[i].adaptiveInterval);
       }
 
     int nIn = negotiationData->nInConnections;
@@ -470,6 +511,8 @@ namespace MUSIC {
 	synch->setMaxBuffered (maxBuffered);
 	synch->setAccLatency (accLatency);
 	synch->setInterpolate (interpolate);
+	synch->setAdaptiveInterval
+	  (negotiationData->connection[nOut + i].adaptiveInterval);
       }
   }
 
@@ -485,10 +528,15 @@ namespace MUSIC {
     if (isLeader ())
       {
 	collectNegotiationData (localTime.tickInterval ());
-	communicateNegotiationData ();
-	combineParameters ();
-	loopAlgorithm ();
-	distributeParameters ();
+	gatherNegotiationData ();
+	// The serial part of negotiation is done by a single leader
+	if (isSolver ())
+	  {
+	    combineParameters ();
+	    loopAlgorithm ();
+	    distributeParameters ();
+	  }
+	scatterNegotiationData ();
 	if (hasPeers ())
 	  broadcastNegotiationData ();
       }
@@ -498,6 +546,41 @@ namespace MUSIC {
   }
 
 
+  /*
+   * Copy the negotiation results of the local process so that they
+   * can be stored in a NegotiationCache
+   */
+
+  void
+  TemporalNegotiator::negotiationResult (std::vector<char>& result)
+  {
+    char* data = static_cast<char*> (static_cast<void*> (negotiationData));
+    result.assign (data, data + negotiationDataSize (nLocalConnections));
+  }
+
+
+  /*
+   * Distribute negotiation results obtained from a NegotiationCache
+   * instead of negotiating
+   */
+
+  void
+  TemporalNegotiator::restore (Clock& localTime,
+			       std::vector<Connection*>* connections,
+			       std::vector<char>& result)
+  {
+    separateConnections (connections);
+    nLocalConnections = outputConnections.size () + inputConnections.size ();
+    if (result.size ()
+	!= static_cast<size_t> (negotiationDataSize (nLocalConnections)))
+      error ("internal error in TemporalNegotiator::restore");
+    negotiationBuffer = allocNegotiationData (1, nLocalConnections);
+    memcpy (negotiationBuffer, &result[0], result.size ());
+    negotiationData = negotiationBuffer;
+    distributeNegotiationData (localTime);
+  }
+
+
   std::string
   ApplicationNode::name ()
   {
@@ -0,0 +1,145 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "music/trace.hh"
+#include "music/statistics.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace MUSIC {
+
+  bool Trace::enabled_ = false;
+  double Trace::origin_ = 0.0;
+  std::vector<Trace::Event> Trace::events_;
+  unsigned int Trace::next_ = 0;
+  long long Trace::nRecorded_ = 0;
+
+
+  void
+  Trace::enable (int capacity)
+  {
+    events_.resize (capacity);
+    next_ = 0;
+    nRecorded_ = 0;
+    // Wtime need not be synchronized between processes.  Measuring
+    // from a common barrier puts all applications on one timeline.
+    MPI::COMM_WORLD.Barrier ();
+    origin_ = MPI::Wtime ();
+    enabled_ = true;
+  }
+
+
+  void
+  Trace::record (const char* name,
+		 double start,
+		 double end,
+		 int peer,
+		 int bytes)
+  {
+    Event& e = events_[next_];
+    e.name = name;
+    e.start = start;
+    e.duration = end - start;
+    e.peer = peer;
+    e.bytes = bytes;
+    if (++next_ == events_.size ())
+      next_ = 0;
+    ++nRecorded_;
+  }
+
+
+  static std::string
+  quote (std::string s)
+  {
+    std::string result = "\"";
+    for (std::string::iterator c = s.begin (); c != s.end (); ++c)
+      {
+	if (*c == '"' || *c == '\\')
+	  result += '\\';
+	result += *c;
+      }
+    return result + "\"";
+  }
+
+
+  void
+  Trace::write (std::string fileName,
+		std::string applicationName,
+		MPI::Intracomm comm)
+  {
+    // Each application is a process and each of its MPI processes a
+    // thread of the trace
+    int worldRank = MPI::COMM_WORLD.Get_rank ();
+    int tid = comm.Get_rank ();
+    int pid = worldRank - tid;
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision (3);
+    if (tid == 0)
+      out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+	  << ",\"tid\":0,\"args\":{\"name\":" << quote (applicationName)
+	  << "}},\n";
+    std::ostringstream threadName;
+    threadName << "rank " << tid << " (world rank " << worldRank << ")";
+    long long nKept = std::min (nRecorded_,
+				static_cast<long long> (events_.size ()));
+    if (nKept < nRecorded_)
+      threadName << ", " << nRecorded_ - nKept << " events dropped";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+	<< ",\"tid\":" << tid << ",\"args\":{\"name\":"
+	<< quote (threadName.str ()) << "}}";
+
+    // Oldest first
+    unsigned int first = nKept < nRecorded_ ? next_ : 0;
+    for (long long i = 0; i < nKept; ++i)
+      {
+	Event& e = events_[(first + i) % events_.size ()];
+	out << ",\n{\"name\":\"" << e.name << "\",\"cat\":\""
+	    << (e.peer < 0 ? "phase" : "transfer")
+	    << "\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << tid
+	    << ",\"ts\":" << 1e6 * (e.start - origin_)
+	    << ",\"dur\":" << 1e6 * e.duration;
+	if (e.peer >= 0)
+	  out << ",\"args\":{\"peer\":" << e.peer
+	      << ",\"bytes\":" << e.bytes << "}";
+	out << "}";
+      }
+
+    std::vector<std::string> all = gatherToRoot (out.str ());
+    if (worldRank != 0)
+      return;
+
+    std::ofstream file (fileName.c_str ());
+    file << "{\"traceEvents\":[\n";
+    for (unsigned int i = 0; i < all.size (); ++i)
+      {
+	if (i > 0)
+	  file << ",\n";
+	file << all[i];
+      }
+    file << "\n],\n\"displayTimeUnit\":\"ms\"}\n";
+    if (!file)
+      std::cerr << "MUSIC: couldn't write trace to " << fileName
+		<< std::endl;
+  }
+
+}
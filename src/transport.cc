@@ -0,0 +1,309 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#include "music/transport.hh"
+#include "music/error.hh"
+
+namespace MUSIC {
+
+  /********************************************************************
+   *
+   * MPI Transports
+   *
+   ********************************************************************/
+
+  void
+  MPIIntracommTransport::send (const void* buffer, int count,
+			       MPI::Datatype type, int dest, int tag)
+  {
+    comm_.Send (buffer, count, type, dest, tag);
+  }
+
+
+  int
+  MPIIntracommTransport::receive (void* buffer, int count,
+				  MPI::Datatype type, int source, int tag)
+  {
+    MPI::Status status;
+    comm_.Recv (buffer, count, type, source, tag, status);
+    return status.Get_count (MPI::BYTE);
+  }
+
+
+  bool
+  MPIIntracommTransport::probe (int source, int tag)
+  {
+    return comm_.Iprobe (source, tag);
+  }
+
+
+  void
+  MPIIntracommTransport::allreduceMax (int* local, int* global, int count)
+  {
+    comm_.Allreduce (local, global, count, MPI::INT, MPI::MAX);
+  }
+
+
+  void
+  MPIIntracommTransport::broadcast (void* buffer, int count,
+				    MPI::Datatype type, int root)
+  {
+    comm_.Bcast (buffer, count, type, root);
+  }
+
+
+  void
+  MPIIntercommTransport::send (const void* buffer, int count,
+			       MPI::Datatype type, int dest, int tag)
+  {
+    comm_.Send (buffer, count, type, dest, tag);
+  }
+
+
+  int
+  MPIIntercommTransport::receive (void* buffer, int count,
+				  MPI::Datatype type, int source, int tag)
+  {
+    MPI::Status status;
+    comm_.Recv (buffer, count, type, source, tag, status);
+    return status.Get_count (MPI::BYTE);
+  }
+
+
+  bool
+  MPIIntercommTransport::probe (int source, int tag)
+  {
+    return comm_.Iprobe (source, tag);
+  }
+
+
+  void
+  MPIIntercommTransport::allreduceMax (int*, int*, int)
+  {
+    error ("internal error: collective on an inter transport");
+  }
+
+
+  void
+  MPIIntercommTransport::broadcast (void*, int, MPI::Datatype, int)
+  {
+    error ("internal error: collective on an inter transport");
+  }
+
+
+  /********************************************************************
+   *
+   * In-process Transport
+   *
+   ********************************************************************/
+
+  LocalNetwork::LocalNetwork ()
+  {
+    pthread_mutex_init (&mutex_, NULL);
+    pthread_cond_init (&delivered_, NULL);
+  }
+
+
+  LocalNetwork::~LocalNetwork ()
+  {
+    pthread_cond_destroy (&delivered_);
+    pthread_mutex_destroy (&mutex_);
+  }
+
+
+  // Groups must be added before communication starts
+  int
+  LocalNetwork::addGroup (int size)
+  {
+    groups_.push_back (size);
+    firstMailbox_.push_back (mailboxes_.size ());
+    mailboxes_.resize (mailboxes_.size () + size);
+    return groups_.size () - 1;
+  }
+
+
+  LocalNetwork::Mailbox&
+  LocalNetwork::mailbox (int group, int rank)
+  {
+    if (group < 0 || group >= static_cast<int> (groups_.size ())
+	|| rank < 0 || rank >= groups_[group])
+      {
+	std::ostringstream msg;
+	msg << "internal error: no local endpoint " << rank
+	    << " in group " << group;
+	error (msg.str ());
+      }
+    return mailboxes_[firstMailbox_[group] + rank];
+  }
+
+
+  // The first message from source with tag
+  LocalNetwork::Mailbox::iterator
+  LocalNetwork::find (Mailbox& mailbox, int sourceGroup, int source, int tag)
+  {
+    for (Mailbox::iterator m = mailbox.begin (); m != mailbox.end (); ++m)
+      if (m->sourceGroup == sourceGroup && m->source == source
+	  && m->tag == tag)
+	return m;
+    return mailbox.end ();
+  }
+
+
+  void
+  LocalNetwork::send (int sourceGroup, int source, int destGroup, int dest,
+		      int tag, const void* data, int size)
+  {
+    Message message;
+    message.sourceGroup = sourceGroup;
+    message.source = source;
+    message.tag = tag;
+    message.data.assign (static_cast<const char*> (data), size);
+    pthread_mutex_lock (&mutex_);
+    mailbox (destGroup, dest).push_back (message);
+    pthread_cond_broadcast (&delivered_);
+    pthread_mutex_unlock (&mutex_);
+  }
+
+
+  int
+  LocalNetwork::receive (int destGroup, int dest, int sourceGroup, int source,
+			 int tag, void* data, int maxSize)
+  {
+    pthread_mutex_lock (&mutex_);
+    Mailbox& box = mailbox (destGroup, dest);
+    Mailbox::iterator m;
+    while ((m = find (box, sourceGroup, source, tag)) == box.end ())
+      pthread_cond_wait (&delivered_, &mutex_);
+    int size = m->data.size ();
+    if (size > maxSize)
+      {
+	pthread_mutex_unlock (&mutex_);
+	std::ostringstream msg;
+	msg << "internal error: local message of " << size
+	    << " bytes truncated to " << maxSize;
+	error (msg.str ());
+      }
+    memcpy (data, m->data.data (), size);
+    box.erase (m);
+    pthread_mutex_unlock (&mutex_);
+    return size;
+  }
+
+
+  bool
+  LocalNetwork::probe (int destGroup, int dest, int sourceGroup, int source,
+		       int tag)
+  {
+    pthread_mutex_lock (&mutex_);
+    Mailbox& box = mailbox (destGroup, dest);
+    bool found = find (box, sourceGroup, source, tag) != box.end ();
+    pthread_mutex_unlock (&mutex_);
+    return found;
+  }
+
+
+  // Collectives use a tag outside the range of MPI tags
+  static const int COLLECTIVE_TAG = -1;
+
+
+  LocalTransport::LocalTransport (LocalNetwork* network,
+				  int group,
+				  int rank,
+				  int remoteGroup)
+    : network_ (network),
+      group_ (group),
+      rank_ (rank),
+      remoteGroup_ (remoteGroup)
+  {
+  }
+
+
+  void
+  LocalTransport::send (const void* buffer, int count, MPI::Datatype type,
+			int dest, int tag)
+  {
+    network_->send (group_, rank_, remoteGroup_, dest, tag,
+		    buffer, count * type.Get_size ());
+  }
+
+
+  int
+  LocalTransport::receive (void* buffer, int count, MPI::Datatype type,
+			   int source, int tag)
+  {
+    return network_->receive (group_, rank_, remoteGroup_, source, tag,
+			      buffer, count * type.Get_size ());
+  }
+
+
+  bool
+  LocalTransport::probe (int source, int tag)
+  {
+    return network_->probe (group_, rank_, remoteGroup_, source, tag);
+  }
+
+
+  // Reduce at rank 0 and broadcast the result
+  void
+  LocalTransport::allreduceMax (int* local, int* global, int count)
+  {
+    if (remoteGroup_ != group_)
+      error ("internal error: collective on an inter transport");
+    std::copy (local, local + count, global);
+    if (rank_ == 0)
+      {
+	std::vector<int> remote (count);
+	for (int r = 1; r < size (); ++r)
+	  {
+	    network_->receive (group_, 0, group_, r, COLLECTIVE_TAG,
+			       &remote[0], count * sizeof (int));
+	    for (int i = 0; i < count; ++i)
+	      global[i] = std::max (global[i], remote[i]);
+	  }
+      }
+    else
+      network_->send (group_, rank_, group_, 0, COLLECTIVE_TAG,
+		      local, count * sizeof (int));
+    broadcast (global, count, MPI::INT, 0);
+  }
+
+
+  void
+  LocalTransport::broadcast (void* buffer, int count, MPI::Datatype type,
+			     int root)
+  {
+    if (remoteGroup_ != group_)
+      error ("internal error: collective on an inter transport");
+    int bytes = count * type.Get_size ();
+    if (rank_ == root)
+      {
+	for (int r = 0; r < size (); ++r)
+	  if (r != root)
+	    network_->send (group_, rank_, group_, r, COLLECTIVE_TAG,
+			    buffer, bytes);
+      }
+    else
+      network_->receive (group_, rank_, group_, root, COLLECTIVE_TAG,
+			 buffer, bytes);
+  }
+
+}
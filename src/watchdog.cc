@@ -0,0 +1,240 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <mpi.h>
+
+#include "music/watchdog.hh"
+#include "music/subconnector.hh"
+#include "music/statistics.hh"
+#include "music/error.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+extern "C" {
+#include <pthread.h>
+#include <sys/time.h>
+#include <unistd.h>
+}
+
+namespace MUSIC {
+
+  bool Watchdog::enabled_ = false;
+  std::map<Subconnector*, Watchdog::Target> Watchdog::targets_;
+
+  // State shared with the watchdog thread, protected by mutex
+  static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  static pthread_cond_t wakeup = PTHREAD_COND_INITIALIZER;
+  static pthread_t thread;
+  static bool stopping = false;
+  static double threshold = 0.0;
+  static std::string applicationName;
+  static int worldRank = -1;
+  static bool inTick = false;
+  static double tickStart = 0.0;
+  static double nextReport = 0.0; // stall duration of the next report
+  static Subconnector* waiting = NULL;
+  static double waitStart = 0.0;
+
+
+  // MPI::Wtime may not be called from the watchdog thread
+  static double
+  now ()
+  {
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    return tv.tv_sec + 1e-6 * tv.tv_usec;
+  }
+
+
+  void
+  Watchdog::addTarget (Subconnector* s,
+		       bool output,
+		       std::string port,
+		       std::string remoteApp)
+  {
+    Target& target = targets_[s];
+    target.output = output;
+    target.port = port;
+    target.remoteApp = remoteApp;
+    target.remoteWorldRank = s->remoteWorldRank ();
+    target.nStalls = 0;
+  }
+
+
+  void
+  Watchdog::start (double t, std::string name)
+  {
+    threshold = t;
+    applicationName = name;
+    worldRank = MPI::COMM_WORLD.Get_rank ();
+    stopping = false;
+    if (pthread_create (&thread, NULL, run, NULL) != 0)
+      error ("couldn't start watchdog thread");
+    enabled_ = true;
+  }
+
+
+  void
+  Watchdog::stop ()
+  {
+    if (!enabled_)
+      return;
+    pthread_mutex_lock (&mutex);
+    stopping = true;
+    pthread_cond_signal (&wakeup);
+    pthread_mutex_unlock (&mutex);
+    pthread_join (thread, NULL);
+    enabled_ = false;
+  }
+
+
+  void
+  Watchdog::setTick (bool t)
+  {
+    pthread_mutex_lock (&mutex);
+    inTick = t;
+    tickStart = now ();
+    nextReport = threshold;
+    pthread_mutex_unlock (&mutex);
+  }
+
+
+  void
+  Watchdog::setWait (Subconnector* s)
+  {
+    pthread_mutex_lock (&mutex);
+    waiting = s;
+    waitStart = now ();
+    pthread_mutex_unlock (&mutex);
+  }
+
+
+  void*
+  Watchdog::run (void*)
+  {
+    // Check a few times per threshold
+    double period = std::max (threshold / 4, 0.01);
+    pthread_mutex_lock (&mutex);
+    while (!stopping)
+      {
+	double wake = now () + period;
+	struct timespec ts;
+	ts.tv_sec = static_cast<time_t> (wake);
+	ts.tv_nsec = static_cast<long> (1e9 * (wake - ts.tv_sec));
+	pthread_cond_timedwait (&wakeup, &mutex, &ts);
+	if (stopping || !inTick)
+	  continue;
+	double t = now ();
+	if (t - tickStart >= nextReport)
+	  {
+	    report (t - tickStart, t);
+	    // A stalled tick is counted once, but reported again each
+	    // time its duration doubles
+	    if (nextReport == threshold && waiting != NULL)
+	      ++targets_[waiting].nStalls;
+	    nextReport *= 2;
+	  }
+      }
+    pthread_mutex_unlock (&mutex);
+    return NULL;
+  }
+
+
+  // Called with mutex held
+  void
+  Watchdog::report (double stalled, double t)
+  {
+    std::ostringstream msg;
+    msg << "MUSIC watchdog: " << applicationName
+	<< " (world rank " << worldRank << "): tick stalled for "
+	<< stalled << " s";
+    if (waiting != NULL)
+      {
+	Target& target = targets_[waiting];
+	msg << ", blocked for " << t - waitStart << " s "
+	    << (target.output ? "sending " : "receiving ") << target.port
+	    << (target.output ? " to " : " from ") << target.remoteApp
+	    << " (world rank " << target.remoteWorldRank << ")";
+      }
+    else
+      msg << ", not blocked in communication";
+    msg << std::endl;
+    // One write so that reports of different processes don't mix
+    std::string s = msg.str ();
+    ssize_t n = write (2, s.data (), s.size ());
+    (void) n;
+  }
+
+
+  void
+  Watchdog::writeWaitForGraph ()
+  {
+    // Lines "application remote-application blocked-time stalls"
+    std::map<std::string, std::pair<double, int> > edges;
+    for (std::map<Subconnector*, Target>::iterator t = targets_.begin ();
+	 t != targets_.end ();
+	 ++t)
+      {
+	std::pair<double, int>& edge = edges[t->second.remoteApp];
+	edge.first += t->first->statistics ().blockedTime;
+	edge.second += t->second.nStalls;
+      }
+    std::ostringstream out;
+    for (std::map<std::string, std::pair<double, int> >::iterator e
+	   = edges.begin ();
+	 e != edges.end ();
+	 ++e)
+      out << applicationName << ' ' << e->first << ' '
+	  << e->second.first << ' ' << e->second.second << '\n';
+
+    std::vector<std::string> all = gatherToRoot (out.str ());
+    if (worldRank != 0)
+      return;
+
+    std::map<std::pair<std::string, std::string>,
+	     std::pair<double, int> > graph;
+    for (std::vector<std::string>::iterator lines = all.begin ();
+	 lines != all.end ();
+	 ++lines)
+      {
+	std::istringstream in (*lines);
+	std::string from, to;
+	double blocked;
+	int nStalls;
+	while (in >> from >> to >> blocked >> nStalls)
+	  {
+	    std::pair<double, int>& edge = graph[std::make_pair (from, to)];
+	    edge.first += blocked;
+	    edge.second += nStalls;
+	  }
+      }
+    std::cerr << "MUSIC wait-for graph (blocked time summed over processes)"
+	      << std::endl;
+    for (std::map<std::pair<std::string, std::string>,
+	   std::pair<double, int> >::iterator e = graph.begin ();
+	 e != graph.end ();
+	 ++e)
+      std::cerr << "  " << e->first.first << " -> " << e->first.second
+		<< ": " << e->second.first << " s blocked, "
+		<< e->second.second << " stalled ticks" << std::endl;
+  }
+
+}
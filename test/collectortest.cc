@@ -0,0 +1,111 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Unit tests of the Collector, which scatters the blocks received
+// from remote processes into the local array of a cont input port.
+// MPI is initialized only because datatype sizes are queried; the
+// program is run directly (not through mpirun) by "make check".
+
+// Leave as first include---required by BG/L
+#include <mpi.h>
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+
+#include "music/collector.hh"
+#include "music/array_data.hh"
+#include "music/linear_index.hh"
+
+using namespace MUSIC;
+
+static int nFailures = 0;
+
+#define CHECK(expr)							\
+  do									\
+    {									\
+      if (!(expr))							\
+	{								\
+	  std::cerr << __FILE__ << ":" << __LINE__			\
+		    << ": check failed: " #expr << std::endl;		\
+	  ++nFailures;							\
+	}								\
+    }									\
+  while (0)
+
+
+// Hand over one block holding the elements of the given local
+// indices, in order of index, with value 100 + index
+static void
+receive (BIFO* buffer, const int* indices, int n)
+{
+  std::vector<double> block (n);
+  for (int i = 0; i < n; ++i)
+    block[i] = 100 + indices[i];
+  memcpy (buffer->insertBlock (), &block[0], n * sizeof (double));
+  buffer->trimBlock (n * sizeof (double));
+}
+
+
+// Each buffer carries two intervals of the local array, so that the
+// second interval of a block must be read after the first one
+static void
+testSeveralIntervals ()
+{
+  const int width = 8;
+  const int guard = 8;
+  std::vector<double> data (width + guard, -1.0);
+  LinearIndex indices (0, width);
+  ArrayData dataMap (&data[0], MPI::DOUBLE, &indices);
+
+  BIFO buffers[2];
+  Collector collector;
+  collector.configure (&dataMap, 1);
+  collector.addRoutingInterval (IndexInterval (0, 2, 0), &buffers[0]);
+  collector.addRoutingInterval (IndexInterval (4, 6, 0), &buffers[0]);
+  collector.addRoutingInterval (IndexInterval (2, 4, 0), &buffers[1]);
+  collector.addRoutingInterval (IndexInterval (6, 8, 0), &buffers[1]);
+  collector.initialize ();
+
+  const int first[] = { 0, 1, 4, 5 };
+  const int second[] = { 2, 3, 6, 7 };
+  receive (&buffers[0], first, 4);
+  receive (&buffers[1], second, 4);
+  collector.collect ();
+
+  for (int i = 0; i < width; ++i)
+    CHECK (data[i] == 100 + i);
+  // Nothing may be written beyond the array
+  for (int i = width; i < width + guard; ++i)
+    CHECK (data[i] == -1.0);
+}
+
+
+int
+main (int argc, char* argv[])
+{
+  MPI::Init (argc, argv);
+  testSeveralIntervals ();
+  MPI::Finalize ();
+  if (nFailures > 0)
+    {
+      std::cerr << nFailures << " checks failed" << std::endl;
+      return 1;
+    }
+  return 0;
+}
@@ -0,0 +1,225 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Unit tests of the loop analysis used by TemporalNegotiator.  This
+// program doesn't initialize MPI and is run directly (not through
+// mpirun) by "make check".
+
+#include <iostream>
+#include <vector>
+
+#include "music/loop_analysis.hh"
+
+using MUSIC::LoopAnalysis;
+
+static int nFailures = 0;
+
+#define CHECK(expr)							\
+  do									\
+    {									\
+      if (!(expr))							\
+	{								\
+	  std::cerr << __FILE__ << ":" << __LINE__			\
+		    << ": check failed: " #expr << std::endl;		\
+	  ++nFailures;							\
+	}								\
+    }									\
+  while (0)
+
+
+// Two applications sending to each other: the headroom is split
+// evenly, as with uniform distribution
+static void
+testSimpleLoop ()
+{
+  LoopAnalysis loops (2);
+  loops.setTickInterval (0, 10);
+  loops.setTickInterval (1, 10);
+  int ab = loops.addEdge (0, 1, 100, 1000);
+  int ba = loops.addEdge (1, 0, 100, 1000);
+  CHECK (loops.solve ());
+  CHECK (loops.allowedBuffer (ab) == 9);
+  CHECK (loops.allowedBuffer (ba) == 9);
+}
+
+
+// Latency shorter than the tick interval can't be met
+static void
+testShortLatency ()
+{
+  LoopAnalysis loops (3);
+  for (int i = 0; i < 3; ++i)
+    loops.setTickInterval (i, 10);
+  loops.addEdge (0, 1, 20, 1000);
+  loops.addEdge (1, 2, 5, 1000);
+  loops.addEdge (2, 1, 10, 1000);
+  CHECK (!loops.solve ());
+  CHECK (loops.shortLoop ().size () == 2);
+  CHECK (loops.shortLoopDelay () == -5);
+}
+
+
+// Edges which are not part of any loop keep their upper bound
+static void
+testNoLoop ()
+{
+  LoopAnalysis loops (3);
+  for (int i = 0; i < 3; ++i)
+    loops.setTickInterval (i, 1);
+  int ab = loops.addEdge (0, 1, 1, 17);
+  int bc = loops.addEdge (1, 2, 1, 42);
+  int ca = loops.addEdge (0, 2, 1, 3);
+  CHECK (loops.solve ());
+  CHECK (loops.allowedBuffer (ab) == 17);
+  CHECK (loops.allowedBuffer (bc) == 42);
+  CHECK (loops.allowedBuffer (ca) == 3);
+}
+
+
+// An edge with a small upper bound leaves headroom to the other
+// edges of its loop
+static void
+testUpperBound ()
+{
+  LoopAnalysis loops (3);
+  for (int i = 0; i < 3; ++i)
+    loops.setTickInterval (i, 1);
+  int ab = loops.addEdge (0, 1, 101, 2);
+  int bc = loops.addEdge (1, 2, 101, 1000);
+  int ca = loops.addEdge (2, 0, 101, 1000);
+  CHECK (loops.solve ());
+  CHECK (loops.allowedBuffer (ab) == 2);
+  CHECK (loops.allowedBuffer (bc) == 149);
+  CHECK (loops.allowedBuffer (ca) == 149);
+}
+
+
+// A tight loop only constrains its own edges
+static void
+testSharedNode ()
+{
+  LoopAnalysis loops (3);
+  for (int i = 0; i < 3; ++i)
+    loops.setTickInterval (i, 1);
+  int ab = loops.addEdge (0, 1, 101, 1000);
+  int ba = loops.addEdge (1, 0, 101, 1000);
+  int bc = loops.addEdge (1, 2, 11, 1000);
+  int cb = loops.addEdge (2, 1, 11, 1000);
+  CHECK (loops.solve ());
+  CHECK (loops.allowedBuffer (ab) == 100);
+  CHECK (loops.allowedBuffer (ba) == 100);
+  CHECK (loops.allowedBuffer (bc) == 10);
+  CHECK (loops.allowedBuffer (cb) == 10);
+}
+
+
+// An application connected to itself
+static void
+testSelfLoop ()
+{
+  LoopAnalysis loops (1);
+  loops.setTickInterval (0, 4);
+  int aa = loops.addEdge (0, 0, 24, 1000);
+  CHECK (loops.solve ());
+  CHECK (loops.allowedBuffer (aa) == 5);
+}
+
+
+// Different tick intervals: the constraint is on buffered time
+static void
+testTickIntervals ()
+{
+  LoopAnalysis loops (2);
+  loops.setTickInterval (0, 1);
+  loops.setTickInterval (1, 10);
+  int ab = loops.addEdge (0, 1, 101, 1000);
+  int ba = loops.addEdge (1, 0, 110, 1000);
+  CHECK (loops.solve ());
+  CHECK (loops.allowedBuffer (ab) == 100);
+  CHECK (loops.allowedBuffer (ba) == 10);
+}
+
+
+// A large ring with chords.  Every loop constraint must hold.
+static void
+testRing ()
+{
+  const int n = 60;
+  const long long ti = 7;
+  LoopAnalysis loops (n);
+  for (int i = 0; i < n; ++i)
+    loops.setTickInterval (i, ti);
+  std::vector<int> pre, post;
+  std::vector<long long> latency;
+  for (int i = 0; i < n; ++i)
+    {
+      int targets[2] = { (i + 1) % n, (i + 7) % n };
+      for (int t = 0; t < 2; ++t)
+	{
+	  long long l = ti * (2 + (i * 13 + t * 5) % 11);
+	  loops.addEdge (i, targets[t], l, 1000);
+	  pre.push_back (i);
+	  post.push_back (targets[t]);
+	  latency.push_back (l);
+	}
+    }
+  CHECK (loops.solve ());
+
+  // Check constraints with Floyd-Warshall over the remaining headroom
+  const long long inf = 1LL << 60;
+  std::vector<std::vector<long long> > d (n, std::vector<long long> (n, inf));
+  for (unsigned int e = 0; e < pre.size (); ++e)
+    {
+      long long w = latency[e] - ti - loops.allowedBuffer (e) * ti;
+      if (w < d[pre[e]][post[e]])
+	d[pre[e]][post[e]] = w;
+    }
+  for (int k = 0; k < n; ++k)
+    for (int i = 0; i < n; ++i)
+      if (d[i][k] < inf)
+	for (int j = 0; j < n; ++j)
+	  if (d[k][j] < inf && d[i][k] + d[k][j] < d[i][j])
+	    d[i][j] = d[i][k] + d[k][j];
+  for (int i = 0; i < n; ++i)
+    CHECK (d[i][i] >= 0);
+
+  // Every edge gets some buffering since all latencies exceed the
+  // tick interval by at least one tick
+  for (unsigned int e = 0; e < pre.size (); ++e)
+    CHECK (loops.allowedBuffer (e) >= 1);
+}
+
+
+int
+main (int argc, char* argv[])
+{
+  testSimpleLoop ();
+  testShortLatency ();
+  testNoLoop ();
+  testUpperBound ();
+  testSharedNode ();
+  testSelfLoop ();
+  testTickIntervals ();
+  testRing ();
+  if (nFailures > 0)
+    {
+      std::cerr << nFailures << " checks failed" << std::endl;
+      return 1;
+    }
+  return 0;
+}
@@ -0,0 +1,661 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Leave as first include---required by BG/L
+#include <mpi.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <getopt.h>
+}
+
+#include "music/array_data.hh"
+#include "music/BIFO.hh"
+#include "music/collector.hh"
+#include "music/distributor.hh"
+#include "music/event.hh"
+#include "music/event_router.hh"
+#include "music/FIBO.hh"
+#include "music/interval_tree.hh"
+#include "music/linear_index.hh"
+#include "music/permutation_index.hh"
+#include "music/sampler.hh"
+#include "music/version.hh"
+
+// music_bench times the data structures used on the data path of
+// MUSIC in a single process, without communication.  Each benchmark
+// is run with a growing number of iterations until it takes at least
+// the minimum time, and the time per iteration is reported.  The
+// json and csv formats are meant to be kept and compared between
+// releases.
+
+using namespace MUSIC;
+
+const double DEFAULT_MIN_TIME = 0.1;
+
+void
+usage ()
+{
+  std::cerr << "Usage: music_bench [OPTION...]" << std::endl
+	    << "`music_bench' runs microbenchmarks of the MUSIC data structures." << std::endl << std::endl
+	    << "  -f, --filter STRING    only run benchmarks with STRING in their name" << std::endl
+	    << "  -m, --min-time SECONDS minimal time per benchmark (default " << DEFAULT_MIN_TIME << " s)" << std::endl
+	    << "  -o, --format FORMAT    console (default), csv or json" << std::endl
+	    << "  -l, --list             list benchmarks without running them" << std::endl
+	    << "  -h, --help             print this help message" << std::endl << std::endl
+	    << "Report bugs to <music-bugs@incf.org>." << std::endl;
+  exit (1);
+}
+
+std::string filter;
+double minTime = DEFAULT_MIN_TIME;
+std::string format = "console";
+bool list = false;
+
+void
+getargs (int argc, char* argv[])
+{
+  opterr = 0; // handle errors ourselves
+  while (1)
+    {
+      static struct option longOptions[] =
+	{
+	  {"filter",   required_argument, 0, 'f'},
+	  {"min-time", required_argument, 0, 'm'},
+	  {"format",   required_argument, 0, 'o'},
+	  {"list",     no_argument,       0, 'l'},
+	  {"help",     no_argument,       0, 'h'},
+	  {0, 0, 0, 0}
+	};
+      /* `getopt_long' stores the option index here. */
+      int option_index = 0;
+
+      // the + below tells getopt_long not to reorder argv
+      int c = getopt_long (argc, argv, "+f:m:o:lh",
+			   longOptions, &option_index);
+
+      /* detect the end of the options */
+      if (c == -1)
+	break;
+
+      switch (c)
+	{
+	case 'f':
+	  filter = optarg;
+	  continue;
+	case 'm':
+	  minTime = atof (optarg);
+	  continue;
+	case 'o':
+	  format = optarg;
+	  if (format != "console" && format != "csv" && format != "json")
+	    usage ();
+	  continue;
+	case 'l':
+	  list = true;
+	  continue;
+	case '?':
+	  break; // ignore unknown options
+	case 'h':
+	  usage ();
+	  continue;
+
+	default:
+	  abort ();
+	}
+    }
+  if (argc != optind)
+    usage ();
+}
+
+
+// Deterministic pseudo-random numbers, so that all runs do the same
+// work
+class Random {
+  unsigned int state_;
+public:
+  Random () : state_ (4711) { }
+  int next (int n)
+  {
+    state_ = state_ * 1103515245 + 12345;
+    return (state_ >> 8) % n;
+  }
+};
+
+
+// Written by benchmarks so that their work isn't optimized away
+volatile long long sink;
+
+
+/*
+ * A benchmark is set up by its constructor and run (n) does n
+ * iterations.  The parameters are part of the name and are also
+ * reported separately.
+ */
+
+class Benchmark {
+protected:
+  std::string function_;
+  int width_;
+  int intervals_;
+  std::string map_;
+public:
+  Benchmark (std::string function, int width, int intervals, std::string map)
+    : function_ (function), width_ (width), intervals_ (intervals), map_ (map)
+  { }
+  virtual ~Benchmark () { }
+  virtual void setUp () { }
+  virtual void tearDown () { }
+  virtual void run (long long n) = 0;
+  // Number of items (indices or events) processed per iteration
+  virtual long long items () { return width_; }
+
+  std::string function () { return function_; }
+  int width () { return width_; }
+  int intervals () { return intervals_; }
+  std::string map () { return map_; }
+  std::string name ()
+  {
+    std::ostringstream name;
+    name << function_;
+    if (width_ > 0)
+      name << "/width:" << width_;
+    if (intervals_ > 0)
+      name << "/intervals:" << intervals_;
+    if (!map_.empty ())
+      name << "/map:" << map_;
+    return name.str ();
+  }
+};
+
+
+// The intervals [k * width / n, (k + 1) * width / n)
+std::vector<IndexInterval>
+split (int width, int n)
+{
+  std::vector<IndexInterval> intervals;
+  for (int k = 0; k < n; ++k)
+    intervals.push_back (IndexInterval (static_cast<long long> (k) * width / n,
+					static_cast<long long> (k + 1) * width / n,
+					0));
+  return intervals;
+}
+
+
+// Index map of the given type over [0, width).  A permutation index
+// consists of intervals runs of consecutive indices in shuffled
+// order.
+IndexMap*
+makeIndexMap (std::string type, int width, int intervals)
+{
+  if (type == "linear")
+    return new LinearIndex (0, width);
+  std::vector<IndexInterval> runs = split (width, intervals);
+  Random random;
+  for (int i = runs.size () - 1; i > 0; --i)
+    std::swap (runs[i], runs[random.next (i + 1)]);
+  std::vector<GlobalIndex> indices;
+  for (std::vector<IndexInterval>::iterator r = runs.begin ();
+       r != runs.end ();
+       ++r)
+    for (int i = r->begin (); i < r->end (); ++i)
+      indices.push_back (i);
+  return new PermutationIndex (&indices[0], indices.size ());
+}
+
+
+class IntervalTreeBuild : public Benchmark {
+  std::vector<IndexInterval> intervals;
+public:
+  IntervalTreeBuild (int n)
+    : Benchmark ("IntervalTree::build", 0, n, "") { }
+  void setUp ()
+  {
+    intervals = split (1 << 30, intervals_);
+    Random random;
+    for (int i = intervals.size () - 1; i > 0; --i)
+      std::swap (intervals[i], intervals[random.next (i + 1)]);
+  }
+  void run (long long n)
+  {
+    for (long long k = 0; k < n; ++k)
+      {
+	IntervalTree<int, IndexInterval> tree;
+	for (std::vector<IndexInterval>::iterator i = intervals.begin ();
+	     i != intervals.end ();
+	     ++i)
+	  tree.add (*i);
+	tree.build ();
+	sink = tree.size ();
+      }
+  }
+  long long items () { return intervals_; }
+};
+
+
+class Counter : public IntervalTree<int, IndexInterval>::Action {
+public:
+  long long n;
+  Counter () : n (0) { }
+  void operator() (IndexInterval&) { ++n; }
+};
+
+
+class IntervalTreeSearch : public Benchmark {
+  IntervalTree<int, IndexInterval> tree;
+  std::vector<int> points;
+public:
+  IntervalTreeSearch (int n)
+    : Benchmark ("IntervalTree::search", 0, n, "") { }
+  void setUp ()
+  {
+    std::vector<IndexInterval> intervals = split (1 << 30, intervals_);
+    for (std::vector<IndexInterval>::iterator i = intervals.begin ();
+	 i != intervals.end ();
+	 ++i)
+      tree.add (*i);
+    tree.build ();
+    Random random;
+    for (int i = 0; i < 4096; ++i)
+      points.push_back (random.next (1 << 30));
+  }
+  void run (long long n)
+  {
+    Counter counter;
+    for (long long k = 0; k < n; ++k)
+      tree.search (points[k & 4095], &counter);
+    sink = counter.n;
+  }
+  long long items () { return 1; }
+};
+
+
+class EventRouterInsertEvent : public Benchmark {
+  static const int N_BUFFERS = 8;
+  EventRouter router;
+  FIBO buffers[N_BUFFERS];
+  std::vector<int> ids;
+public:
+  EventRouterInsertEvent (int width, int intervals)
+    : Benchmark ("EventRouter::insertEvent", width, intervals, "") { }
+  void setUp ()
+  {
+    for (int b = 0; b < N_BUFFERS; ++b)
+      buffers[b].configure (sizeof (Event));
+    std::vector<IndexInterval> intervals = split (width_, intervals_);
+    for (unsigned int i = 0; i < intervals.size (); ++i)
+      router.insertRoutingInterval (intervals[i], &buffers[i % N_BUFFERS]);
+    router.buildTable ();
+    Random random;
+    for (int i = 0; i < 4096; ++i)
+      ids.push_back (random.next (width_));
+  }
+  void run (long long n)
+  {
+    for (long long k = 0; k < n; ++k)
+      {
+	router.insertEvent (1e-3 * k, GlobalIndex (ids[k & 4095]));
+	// Keep the buffers small, as after each communication
+	if ((k & 4095) == 4095)
+	  for (int b = 0; b < N_BUFFERS; ++b)
+	    buffers[b].clear ();
+      }
+  }
+  long long items () { return 1; }
+};
+
+
+class FIBOInsert : public Benchmark {
+  FIBO buffer;
+public:
+  FIBOInsert () : Benchmark ("FIBO::insert", 0, 0, "") { }
+  void setUp () { buffer.configure (sizeof (Event)); }
+  void run (long long n)
+  {
+    for (long long k = 0; k < n; ++k)
+      {
+	Event* e = static_cast<Event*> (buffer.insert ());
+	e->t = 1e-3 * k;
+	e->id = k;
+	if ((k & 4095) == 4095)
+	  buffer.clear ();
+      }
+  }
+  long long items () { return 1; }
+};
+
+
+// One block of width doubles passes through the buffer per iteration
+class BIFOInsertBlockNext : public Benchmark {
+  BIFO buffer;
+  std::vector<double> data;
+public:
+  BIFOInsertBlockNext (int width)
+    : Benchmark ("BIFO::insertBlock+next", width, 0, "") { }
+  void setUp ()
+  {
+    data.resize (width_, 1.0);
+    buffer.configure (width_ * sizeof (double), width_ * sizeof (double));
+  }
+  void run (long long n)
+  {
+    int size = width_ * sizeof (double);
+    for (long long k = 0; k < n; ++k)
+      {
+	void* block = buffer.insertBlock ();
+	std::copy (data.begin (), data.end (), static_cast<double*> (block));
+	buffer.trimBlock (size);
+	sink = *static_cast<char*> (buffer.next ());
+      }
+  }
+};
+
+
+class SamplerInterpolate : public Benchmark {
+  std::vector<double> data;
+  IndexMap* indices;
+  ArrayData* dataMap;
+  Sampler sampler;
+public:
+  SamplerInterpolate (int width, int intervals, std::string map)
+    : Benchmark ("Sampler::interpolate", width, intervals, map) { }
+  void setUp ()
+  {
+    data.resize (width_, 1.0);
+    indices = makeIndexMap (map_, width_, intervals_);
+    dataMap = new ArrayData (&data[0], MPI::DOUBLE, indices);
+    sampler.configure (dataMap);
+    sampler.initialize ();
+    sampler.sample ();
+    sampler.sample ();
+  }
+  void tearDown ()
+  {
+    delete dataMap;
+    delete indices;
+  }
+  void run (long long n)
+  {
+    for (long long k = 0; k < n; ++k)
+      sampler.interpolate (0.5);
+  }
+};
+
+
+// Routing intervals are spread over a few buffers, as when a port is
+// connected to several remote processes
+const int N_REMOTE = 4;
+
+class DistributorDistribute : public Benchmark {
+  std::vector<double> data;
+  IndexMap* indices;
+  ArrayData* dataMap;
+  Distributor distributor;
+  FIBO buffers[N_REMOTE];
+public:
+  DistributorDistribute (int width, int intervals, std::string map)
+    : Benchmark ("Distributor::distribute", width, intervals, map) { }
+  void setUp ()
+  {
+    data.resize (width_, 1.0);
+    indices = makeIndexMap (map_, width_, intervals_);
+    dataMap = new ArrayData (&data[0], MPI::DOUBLE, indices);
+    distributor.configure (dataMap);
+    std::vector<IndexInterval> intervals = split (width_, intervals_);
+    for (unsigned int i = 0; i < intervals.size (); ++i)
+      distributor.addRoutingInterval (intervals[i], &buffers[i % N_REMOTE]);
+    distributor.initialize ();
+  }
+  void tearDown ()
+  {
+    delete dataMap;
+    delete indices;
+  }
+  void run (long long n)
+  {
+    for (long long k = 0; k < n; ++k)
+      {
+	distributor.distribute ();
+	for (int b = 0; b < N_REMOTE; ++b)
+	  buffers[b].clear ();
+      }
+  }
+};
+
+
+class CollectorCollect : public Benchmark {
+  std::vector<double> data;
+  IndexMap* indices;
+  ArrayData* dataMap;
+  Collector collector;
+  BIFO buffers[N_REMOTE];
+  int blockSize[N_REMOTE];
+public:
+  CollectorCollect (int width, int intervals, std::string map)
+    : Benchmark ("Collector::collect", width, intervals, map) { }
+  void setUp ()
+  {
+    data.resize (width_, 0.0);
+    indices = makeIndexMap (map_, width_, intervals_);
+    dataMap = new ArrayData (&data[0], MPI::DOUBLE, indices);
+    collector.configure (dataMap, 1);
+    std::vector<IndexInterval> intervals = split (width_, intervals_);
+    for (int b = 0; b < N_REMOTE; ++b)
+      blockSize[b] = 0;
+    for (unsigned int i = 0; i < intervals.size (); ++i)
+      {
+	collector.addRoutingInterval (intervals[i], &buffers[i % N_REMOTE]);
+	blockSize[i % N_REMOTE] += ((intervals[i].end () - intervals[i].begin ())
+				    * sizeof (double));
+      }
+    collector.initialize ();
+  }
+  void tearDown ()
+  {
+    delete dataMap;
+    delete indices;
+  }
+  void run (long long n)
+  {
+    for (long long k = 0; k < n; ++k)
+      {
+	// Receiving is simulated by handing over one block per buffer
+	for (int b = 0; b < N_REMOTE; ++b)
+	  if (blockSize[b] > 0)
+	    {
+	      buffers[b].insertBlock ();
+	      buffers[b].trimBlock (blockSize[b]);
+	    }
+	collector.collect ();
+      }
+  }
+};
+
+
+std::vector<Benchmark*>
+makeBenchmarks ()
+{
+  std::vector<Benchmark*> benchmarks;
+  const char* maps[] = { "linear", "permutation" };
+
+  for (int n = 16; n <= 65536; n *= 64)
+    benchmarks.push_back (new IntervalTreeBuild (n));
+  for (int n = 16; n <= 65536; n *= 64)
+    benchmarks.push_back (new IntervalTreeSearch (n));
+  for (int width = 1024; width <= 1 << 20; width *= 1024)
+    for (int intervals = 1; intervals <= 4096; intervals *= 64)
+      if (intervals <= width)
+	benchmarks.push_back (new EventRouterInsertEvent (width, intervals));
+  benchmarks.push_back (new FIBOInsert ());
+  for (int width = 1; width <= 65536; width *= 256)
+    benchmarks.push_back (new BIFOInsertBlockNext (width));
+  for (int width = 1024; width <= 65536; width *= 64)
+    for (int m = 0; m < 2; ++m)
+      benchmarks.push_back (new SamplerInterpolate (width, 64, maps[m]));
+  for (int width = 1024; width <= 65536; width *= 64)
+    for (int intervals = 1; intervals <= 1024; intervals *= 32)
+      for (int m = 0; m < 2; ++m)
+	benchmarks.push_back (new DistributorDistribute (width,
+							 intervals,
+							 maps[m]));
+  for (int width = 1024; width <= 65536; width *= 64)
+    for (int intervals = 1; intervals <= 1024; intervals *= 32)
+      for (int m = 0; m < 2; ++m)
+	benchmarks.push_back (new CollectorCollect (width,
+						    intervals,
+						    maps[m]));
+  return benchmarks;
+}
+
+
+struct Result {
+  long long iterations;
+  double seconds;
+};
+
+
+// Grow the number of iterations until the run takes minTime
+Result
+measure (Benchmark* benchmark)
+{
+  Result result;
+  long long n = 1;
+  while (true)
+    {
+      double start = MPI::Wtime ();
+      benchmark->run (n);
+      double elapsed = MPI::Wtime () - start;
+      if (elapsed >= minTime || n >= 1000000000LL)
+	{
+	  result.iterations = n;
+	  result.seconds = elapsed;
+	  return result;
+	}
+      double factor = elapsed > 0.0 ? 1.4 * minTime / elapsed : 10.0;
+      n = static_cast<long long> (n * std::max (2.0, std::min (10.0, factor)));
+    }
+}
+
+
+std::string
+jsonString (std::string s)
+{
+  return "\"" + s + "\"";
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  MPI::Init (argc, argv);
+  getargs (argc, argv);
+
+  std::vector<Benchmark*> benchmarks = makeBenchmarks ();
+
+  if (format == "csv")
+    std::cout << "name,function,width,intervals,map,iterations,ns_per_iteration,items_per_second" << std::endl;
+  else if (format == "json")
+    {
+      char date[64];
+      time_t now = time (NULL);
+      strftime (date, sizeof (date), "%Y-%m-%dT%H:%M:%S", localtime (&now));
+      std::cout << "{" << std::endl
+		<< "  \"context\": {" << std::endl
+		<< "    \"date\": " << jsonString (date) << "," << std::endl
+		<< "    \"music_version\": " << jsonString (MUSIC::version ())
+		<< "," << std::endl
+		<< "    \"min_time\": " << minTime << std::endl
+		<< "  }," << std::endl
+		<< "  \"benchmarks\": [";
+    }
+
+  bool first = true;
+  for (std::vector<Benchmark*>::iterator b = benchmarks.begin ();
+       b != benchmarks.end ();
+       ++b)
+    {
+      Benchmark* benchmark = *b;
+      if (benchmark->name ().find (filter) == std::string::npos)
+	continue;
+      if (list)
+	{
+	  std::cout << benchmark->name () << std::endl;
+	  continue;
+	}
+      benchmark->setUp ();
+      Result r = measure (benchmark);
+      benchmark->tearDown ();
+      double ns = 1e9 * r.seconds / r.iterations;
+      double itemsPerSecond = benchmark->items () * r.iterations / r.seconds;
+      if (format == "console")
+	{
+	  char line[256];
+	  snprintf (line, sizeof (line), "%-64s %14.1f ns %12lld %12.4g items/s",
+		    benchmark->name ().c_str (), ns, r.iterations,
+		    itemsPerSecond);
+	  std::cout << line << std::endl;
+	}
+      else if (format == "csv")
+	std::cout << benchmark->name () << ',' << benchmark->function ()
+		  << ',' << benchmark->width () << ','
+		  << benchmark->intervals () << ',' << benchmark->map ()
+		  << ',' << r.iterations << ',' << ns << ','
+		  << itemsPerSecond << std::endl;
+      else
+	{
+	  std::cout << (first ? "" : ",") << std::endl
+		    << "    {" << std::endl
+		    << "      \"name\": " << jsonString (benchmark->name ())
+		    << "," << std::endl
+		    << "      \"function\": "
+		    << jsonString (benchmark->function ()) << "," << std::endl
+		    << "      \"width\": " << benchmark->width () << ","
+		    << std::endl
+		    << "      \"intervals\": " << benchmark->intervals () << ","
+		    << std::endl
+		    << "      \"map\": " << jsonString (benchmark->map ()) << ","
+		    << std::endl
+		    << "      \"iterations\": " << r.iterations << ","
+		    << std::endl
+		    << "      \"real_time\": " << ns << "," << std::endl
+		    << "      \"time_unit\": \"ns\"," << std::endl
+		    << "      \"items_per_second\": " << itemsPerSecond
+		    << std::endl
+		    << "    }";
+	}
+      first = false;
+    }
+  if (format == "json")
+    std::cout << std::endl << "  ]" << std::endl << "}" << std::endl;
+
+  for (std::vector<Benchmark*>::iterator b = benchmarks.begin ();
+       b != benchmarks.end ();
+       ++b)
+    delete *b;
+
+  MPI::Finalize ();
+  return 0;
+}
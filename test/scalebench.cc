@@ -0,0 +1,314 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Leave as first include---required by BG/L
+#include <mpi.h>
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+extern "C" {
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <getopt.h>
+}
+
+#include <music.hh>
+
+// scalebench is one side of an end-to-end benchmark of a pair of
+// applications.  It is run by scalebench.sh, which connects a sending
+// and a receiving instance and sweeps over the parameters.  Each
+// instance prints a single line of key=value pairs: setup time
+// (Setup and Runtime construction), wall clock ticks and events per
+// second during the simulation loop, and the largest resident set
+// size of its processes.  The sender can run ahead of the
+// receiver as far as buffering allows, so the start and stop times
+// of the loop are also printed.  scalebench.sh runs on a single node
+// and uses them to compute rates over the span of both loops.
+
+const double DEFAULT_TIMESTEP = 1e-3;
+const int    DEFAULT_WIDTH = 100;
+const double DEFAULT_RATE = 10.0;
+
+void
+usage (int rank)
+{
+  if (rank == 0)
+    {
+      std::cerr << "Usage: scalebench [OPTION...] event|cont out|in N_PORTS" << std::endl
+		<< "`scalebench' sends or receives data on N_PORTS ports and" << std::endl
+		<< "reports performance." << std::endl << std:: endl
+		<< "  -t, --timestep TIMESTEP time between tick() calls (default " << DEFAULT_TIMESTEP << " s)" << std::endl
+		<< "  -w, --width WIDTH       width of each port (default " << DEFAULT_WIDTH << ")" << std::endl
+		<< "  -r, --rate RATE         events per second and index (default " << DEFAULT_RATE << " Hz)" << std::endl
+		<< "  -l, --latency SECONDS   accepted latency or delay of input ports" << std::endl
+		<< "  -b, --maxbuffered TICKS maximal amount of data buffered" << std::endl
+		<< "  -h, --help              print this help message" << std::endl << std::endl
+		<< "Report bugs to <music-bugs@incf.org>." << std::endl;
+    }
+  exit (1);
+}
+
+double timestep = DEFAULT_TIMESTEP;
+int    width = DEFAULT_WIDTH;
+double rate = DEFAULT_RATE;
+double latency = 0.0;
+int    maxbuffered = 0;
+bool   events;
+bool   output;
+int    nPorts;
+
+void
+getargs (int rank, int argc, char* argv[])
+{
+  opterr = 0; // handle errors ourselves
+  while (1)
+    {
+      static struct option longOptions[] =
+	{
+	  {"timestep",    required_argument, 0, 't'},
+	  {"width",       required_argument, 0, 'w'},
+	  {"rate",        required_argument, 0, 'r'},
+	  {"latency",     required_argument, 0, 'l'},
+	  {"maxbuffered", required_argument, 0, 'b'},
+	  {"help",        no_argument,       0, 'h'},
+	  {0, 0, 0, 0}
+	};
+      /* `getopt_long' stores the option index here. */
+      int option_index = 0;
+
+      // the + below tells getopt_long not to reorder argv
+      int c = getopt_long (argc, argv, "+t:w:r:l:b:h",
+			   longOptions, &option_index);
+
+      /* detect the end of the options */
+      if (c == -1)
+	break;
+
+      switch (c)
+	{
+	case 't':
+	  timestep = atof (optarg);
+	  continue;
+	case 'w':
+	  width = atoi (optarg);
+	  continue;
+	case 'r':
+	  rate = atof (optarg);
+	  continue;
+	case 'l':
+	  latency = atof (optarg);
+	  continue;
+	case 'b':
+	  maxbuffered = atoi (optarg);
+	  continue;
+	case '?':
+	  break; // ignore unknown options
+	case 'h':
+	  usage (rank);
+	  continue;
+
+	default:
+	  abort ();
+	}
+    }
+
+  if (argc != optind + 3)
+    usage (rank);
+  std::string kind = argv[optind];
+  if (kind != "event" && kind != "cont")
+    usage (rank);
+  events = kind == "event";
+  std::string direction = argv[optind + 1];
+  if (direction != "out" && direction != "in")
+    usage (rank);
+  output = direction == "out";
+  nPorts = atoi (argv[optind + 2]);
+}
+
+
+double
+wallTime ()
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+
+class EventCounter : public MUSIC::EventHandlerGlobalIndex {
+public:
+  long long n;
+  EventCounter () : n (0) { }
+  void operator () (double, MUSIC::GlobalIndex) { ++n; }
+};
+
+
+int
+main (int argc, char *argv[])
+{
+  double setupStart = wallTime ();
+  MUSIC::Setup* setup = new MUSIC::Setup (argc, argv);
+
+  MPI::Intracomm comm = setup->communicator ();
+  int nProcesses = comm.Get_size ();
+  int rank = comm.Get_rank ();
+
+  getargs (rank, argc, argv);
+
+  // Each port is distributed evenly over the processes
+  int localWidth = width / nProcesses;
+  int rest = width % nProcesses;
+  int firstId = rank * localWidth + (rank < rest ? rank : rest);
+  if (rank < rest)
+    ++localWidth;
+
+  std::vector<double> data (nPorts * localWidth, rank);
+  MUSIC::LinearIndex indices (firstId, localWidth);
+  std::vector<MUSIC::ArrayData*> maps;
+  std::vector<MUSIC::EventOutputPort*> outputs;
+  EventCounter counter;
+  for (int i = 0; i < nPorts; ++i)
+    {
+      std::ostringstream name;
+      name << "p" << i;
+      if (events && output)
+	{
+	  MUSIC::EventOutputPort* out = setup->publishEventOutput (name.str ());
+	  if (maxbuffered > 0)
+	    out->map (&indices, MUSIC::Index::GLOBAL, maxbuffered);
+	  else
+	    out->map (&indices, MUSIC::Index::GLOBAL);
+	  outputs.push_back (out);
+	}
+      else if (events)
+	{
+	  MUSIC::EventInputPort* in = setup->publishEventInput (name.str ());
+	  if (maxbuffered > 0)
+	    in->map (&indices, &counter, latency, maxbuffered);
+	  else
+	    in->map (&indices, &counter, latency);
+	}
+      else
+	{
+	  MUSIC::ArrayData* dmap
+	    = new MUSIC::ArrayData (&data[i * localWidth],
+				    MPI::DOUBLE,
+				    firstId,
+				    localWidth);
+	  maps.push_back (dmap);
+	  if (output)
+	    {
+	      MUSIC::ContOutputPort* out
+		= setup->publishContOutput (name.str ());
+	      if (maxbuffered > 0)
+		out->map (dmap, maxbuffered);
+	      else
+		out->map (dmap);
+	    }
+	  else
+	    {
+	      MUSIC::ContInputPort* in = setup->publishContInput (name.str ());
+	      if (maxbuffered > 0)
+		in->map (dmap, latency, maxbuffered, false);
+	      else
+		in->map (dmap, latency, false);
+	    }
+	}
+    }
+
+  double stoptime;
+  setup->config ("stoptime", &stoptime);
+
+  MUSIC::Runtime* runtime = new MUSIC::Runtime (setup, timestep);
+  double setupTime = wallTime () - setupStart;
+
+  // Events are spread evenly over the local indices and the tick
+  double eventsPerTick = localWidth * rate * timestep;
+  double due = 0.0;
+  long long nSent = 0;
+  int nextId = 0;
+
+  comm.Barrier ();
+  double start = wallTime ();
+  int nTicks = 0;
+  while (runtime->time () < stoptime)
+    {
+      if (events && output && localWidth > 0)
+	{
+	  due += eventsPerTick;
+	  double t = runtime->time ();
+	  for (; due >= 1.0; due -= 1.0)
+	    {
+	      for (int i = 0; i < nPorts; ++i)
+		outputs[i]->insertEvent (t, MUSIC::GlobalIndex (firstId
+								 + nextId));
+	      nextId = (nextId + 1) % localWidth;
+	      nSent += nPorts;
+	    }
+	}
+      runtime->tick ();
+      ++nTicks;
+    }
+  double stop = wallTime ();
+  double elapsed = stop - start;
+
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  long long localCounts[2] = { nSent + counter.n, usage.ru_maxrss };
+  long long counts[2];
+  comm.Reduce (&localCounts[0], &counts[0], 1, MPI::LONG_LONG, MPI::SUM, 0);
+  comm.Reduce (&localCounts[1], &counts[1], 1, MPI::LONG_LONG, MPI::MAX, 0);
+  double maxSetupTime;
+  comm.Reduce (&setupTime, &maxSetupTime, 1, MPI::DOUBLE, MPI::MAX, 0);
+  double lastStop;
+  comm.Reduce (&stop, &lastStop, 1, MPI::DOUBLE, MPI::MAX, 0);
+
+  if (rank == 0)
+    std::cout << "scalebench"
+	      << " kind=" << (events ? "event" : "cont")
+	      << " side=" << (output ? "out" : "in")
+	      << " np=" << nProcesses
+	      << " ports=" << nPorts
+	      << " width=" << width
+	      << " rate=" << rate
+	      << " latency=" << latency
+	      << " maxbuffered=" << maxbuffered
+	      << " ticks=" << nTicks
+	      << " setup_s=" << maxSetupTime
+	      << " ticks_per_s=" << nTicks / elapsed
+	      << " events=" << counts[0]
+	      << " events_per_s=" << counts[0] / elapsed
+	      << std::fixed << std::setprecision (6)
+	      << " start=" << start
+	      << " stop=" << lastStop
+	      << " maxrss_kb=" << counts[1] << std::endl;
+
+  runtime->finalize ();
+
+  delete runtime;
+  for (unsigned int i = 0; i < maps.size (); ++i)
+    delete maps[i];
+
+  return 0;
+}
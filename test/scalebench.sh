@@ -0,0 +1,114 @@
+#!/bin/sh
+#
+# Usage: scalebench.sh [KIND...]
+#
+# Runs a sending and a receiving scalebench connected by PORTS ports
+# of width WIDTH for each point in the sweep over NP (processes per
+# application), PORTS, WIDTH, RATE (events per second and index),
+# LATENCY (accepted latency or delay) and MAXBUFFERED (ticks, 0 for
+# the default).  KIND is event, cont or both (default).  Each
+# variable holds a space separated list of values, for example
+#
+#   NP="1 2 4" WIDTH="1000 100000" ./scalebench.sh event
+#
+# One line of CSV is printed per point with wall clock ticks and
+# events per second of the receiver, the setup time and the largest
+# resident set size of any process.  STOPTIME is the simulated time
+# of each run.  If SHARED_MEMORY is set, it is passed as the
+# shared_memory variable (ring size in bytes) so that co-located
+# processes communicate through shared memory.  If EVENT_AGGREGATION
+# is set, it is passed as the event_aggregation variable (message
+# size limit in bytes) so that event traffic may be aggregated
+# through node leaders.  MPIRUN and MUSIC can be set to choose the
+# mpirun and music commands.
+
+KINDS=${*:-event cont}
+NP=${NP:-1 2}
+PORTS=${PORTS:-1 10}
+WIDTH=${WIDTH:-100 10000}
+RATE=${RATE:-10}
+LATENCY=${LATENCY:-0}
+MAXBUFFERED=${MAXBUFFERED:-0}
+STOPTIME=${STOPTIME:-1.0}
+MPIRUN=${MPIRUN:-mpirun}
+MUSIC=${MUSIC:-music}
+DIR=`dirname $0`
+CONFIG=scalebench.$$.music
+OUTPUT=scalebench.$$.out
+
+# Print the value of KEY from a line of scalebench output
+value ()
+{
+    echo "$1" | tr ' ' '\n' | sed -n "s/^$2=//p"
+}
+
+max ()
+{
+    awk "BEGIN { OFMT = \"%.6f\"; print ($1 > $2 ? $1 : $2) }"
+}
+
+min ()
+{
+    awk "BEGIN { OFMT = \"%.6f\"; print ($1 < $2 ? $1 : $2) }"
+}
+
+echo "kind,np,ports,width,rate,latency,maxbuffered,ticks,ticks_per_s,events_per_s,setup_s,maxrss_kb"
+status=0
+for kind in $KINDS; do
+for np in $NP; do
+for ports in $PORTS; do
+for width in $WIDTH; do
+for rate in $RATE; do
+for latency in $LATENCY; do
+for maxbuffered in $MAXBUFFERED; do
+    args="-w $width -r $rate -l $latency -b $maxbuffered"
+    {
+	echo "stoptime=$STOPTIME"
+	if [ -n "$SHARED_MEMORY" ]; then
+	    echo "shared_memory=$SHARED_MEMORY"
+	fi
+	if [ -n "$EVENT_AGGREGATION" ]; then
+	    echo "event_aggregation=$EVENT_AGGREGATION"
+	fi
+	echo "[out]"
+	echo "  np=$np"
+	echo "  binary=$DIR/scalebench"
+	echo "  args=$args $kind out $ports"
+	echo "[in]"
+	echo "  np=$np"
+	echo "  binary=$DIR/scalebench"
+	echo "  args=$args $kind in $ports"
+	i=0
+	while [ $i -lt $ports ]; do
+	    echo "  out.p$i -> in.p$i [$width]"
+	    i=`expr $i + 1`
+	done
+    } > $CONFIG
+
+    if ! $MPIRUN -np `expr 2 \* $np` $MUSIC $CONFIG > $OUTPUT; then
+	echo "scalebench.sh: run failed: $kind np=$np ports=$ports width=$width rate=$rate latency=$latency maxbuffered=$maxbuffered" >&2
+	status=1
+	continue
+    fi
+    out=`grep "side=out" $OUTPUT`
+    in=`grep "side=in" $OUTPUT`
+    # Rates are computed over the span of both loops, since the
+    # sender can run ahead of the receiver
+    start=`min \`value "$out" start\` \`value "$in" start\``
+    stop=`max \`value "$out" stop\` \`value "$in" stop\``
+    ticks=`value "$in" ticks`
+    events=`value "$in" events`
+    rates=`awk "BEGIN { span = $stop - $start; print $ticks / span \",\" $events / span }"`
+    setup=`max \`value "$out" setup_s\` \`value "$in" setup_s\``
+    rss=`max \`value "$out" maxrss_kb\` \`value "$in" maxrss_kb\``
+    echo "$kind,$np,$ports,$width,$rate,$latency,$maxbuffered,$ticks,$rates,$setup,$rss"
+done
+done
+done
+done
+done
+done
+done
+
+rm -f $CONFIG $OUTPUT
+exit $status
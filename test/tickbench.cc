@@ -0,0 +1,183 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Leave as first include---required by BG/L
+#include <mpi.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+
+extern "C" {
+#include <unistd.h>
+#include <getopt.h>
+}
+
+#include <music.hh>
+
+// tickbench measures the time spent in Runtime::tick by an
+// application with many continuous ports of width one.  It is run by
+// tickbench.sh, which connects a sending and a receiving instance.
+// Processor time rather than wall clock time is measured so that the
+// result is meaningful also when the two instances share a core.
+
+const double DEFAULT_TIMESTEP = 1e-3;
+
+void
+usage (int rank)
+{
+  if (rank == 0)
+    {
+      std::cerr << "Usage: tickbench [OPTION...] out|in N_PORTS" << std::endl
+		<< "`tickbench' measures the time per tick() call with" << std::endl
+		<< "N_PORTS continuous output or input ports." << std::endl << std:: endl
+		<< "  -t, --timestep TIMESTEP time between tick() calls (default " << DEFAULT_TIMESTEP << " s)" << std::endl
+		<< "  -b, --maxbuffered TICKS maximal amount of data buffered" << std::endl
+		<< "  -h, --help              print this help message" << std::endl << std::endl
+		<< "Report bugs to <music-bugs@incf.org>." << std::endl;
+    }
+  exit (1);
+}
+
+double timestep = DEFAULT_TIMESTEP;
+int    maxbuffered = 0;
+bool   output;
+int    nPorts;
+
+void
+getargs (int rank, int argc, char* argv[])
+{
+  opterr = 0; // handle errors ourselves
+  while (1)
+    {
+      static struct option longOptions[] =
+	{
+	  {"timestep",    required_argument, 0, 't'},
+	  {"maxbuffered", required_argument, 0, 'b'},
+	  {"help",        no_argument,       0, 'h'},
+	  {0, 0, 0, 0}
+	};
+      /* `getopt_long' stores the option index here. */
+      int option_index = 0;
+
+      // the + below tells getopt_long not to reorder argv
+      int c = getopt_long (argc, argv, "+t:b:h",
+			   longOptions, &option_index);
+
+      /* detect the end of the options */
+      if (c == -1)
+	break;
+
+      switch (c)
+	{
+	case 't':
+	  timestep = atof (optarg);
+	  continue;
+	case 'b':
+	  maxbuffered = atoi (optarg);
+	  continue;
+	case '?':
+	  break; // ignore unknown options
+	case 'h':
+	  usage (rank);
+	  continue;
+
+	default:
+	  abort ();
+	}
+    }
+
+  if (argc != optind + 2)
+    usage (rank);
+  std::string direction = argv[optind];
+  if (direction != "out" && direction != "in")
+    usage (rank);
+  output = direction == "out";
+  nPorts = atoi (argv[optind + 1]);
+}
+
+int
+main (int argc, char *argv[])
+{
+  MUSIC::Setup* setup = new MUSIC::Setup (argc, argv);
+  
+  MPI::Intracomm comm = setup->communicator ();
+  int rank = comm.Get_rank ();
+  
+  getargs (rank, argc, argv);
+
+  // All ports have width one and live in rank 0
+  int localWidth = rank == 0 ? 1 : 0;
+  std::vector<double> data (nPorts, rank);
+  std::vector<MUSIC::ArrayData*> maps;
+  for (int i = 0; i < nPorts; ++i)
+    {
+      std::ostringstream name;
+      name << "p" << i;
+      MUSIC::ArrayData* dmap
+	= new MUSIC::ArrayData (&data[i], MPI::DOUBLE, 0, localWidth);
+      maps.push_back (dmap);
+      if (output)
+	{
+	  MUSIC::ContOutputPort* out = setup->publishContOutput (name.str ());
+	  if (maxbuffered > 0)
+	    out->map (dmap, maxbuffered);
+	  else
+	    out->map (dmap);
+	}
+      else
+	{
+	  MUSIC::ContInputPort* in = setup->publishContInput (name.str ());
+	  if (maxbuffered > 0)
+	    in->map (dmap, 0.0, maxbuffered, false);
+	  else
+	    in->map (dmap, 0.0, false);
+	}
+    }
+
+  double stoptime;
+  setup->config ("stoptime", &stoptime);
+
+  MUSIC::Runtime* runtime = new MUSIC::Runtime (setup, timestep);
+
+  comm.Barrier ();
+  std::clock_t start = std::clock ();
+  int nTicks = 0;
+  while (runtime->time () < stoptime)
+    {
+      runtime->tick ();
+      ++nTicks;
+    }
+  double elapsed = static_cast<double> (std::clock () - start) / CLOCKS_PER_SEC;
+
+  if (rank == 0)
+    std::cout << "tickbench " << (output ? "out" : "in")
+	      << ": " << nPorts << " ports, " << nTicks << " ticks, "
+	      << 1e6 * elapsed / nTicks << " us/tick" << std::endl;
+
+  runtime->finalize ();
+
+  delete runtime;
+  for (unsigned int i = 0; i < maps.size (); ++i)
+    delete maps[i];
+
+  return 0;
+}
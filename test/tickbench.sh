@@ -0,0 +1,38 @@
+#!/bin/sh
+#
+# Usage: tickbench.sh [N_PORTS [N_TICKS [MAXBUFFERED]]]
+#
+# Connects N_PORTS continuous ports of a sending and a receiving
+# tickbench, each running on one process, and prints the processor
+# time per tick on each side.  MPIRUN and MUSIC can be set to choose
+# the mpirun and music commands.
+
+NPORTS=${1:-1000}
+NTICKS=${2:-10000}
+MAXBUFFERED=${3:-1000}
+MPIRUN=${MPIRUN:-mpirun}
+MUSIC=${MUSIC:-music}
+DIR=`dirname $0`
+CONFIG=tickbench.$$.music
+
+{
+    echo "stoptime=`awk "BEGIN { print $NTICKS * 0.001 }"`"
+    echo "[out]"
+    echo "  np=1"
+    echo "  binary=$DIR/tickbench"
+    echo "  args=-b $MAXBUFFERED out $NPORTS"
+    echo "[in]"
+    echo "  np=1"
+    echo "  binary=$DIR/tickbench"
+    echo "  args=-b $MAXBUFFERED in $NPORTS"
+    i=0
+    while [ $i -lt $NPORTS ]; do
+	echo "  out.p$i -> in.p$i [1]"
+	i=`expr $i + 1`
+    done
+} > $CONFIG
+
+$MPIRUN -np 2 $MUSIC $CONFIG
+status=$?
+rm -f $CONFIG
+exit $status
@@ -0,0 +1,330 @@
+/*
+ *  This file is part of MUSIC.
+ *  Copyright (C) 2014 INCF
+ *
+ *  MUSIC is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MUSIC is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Unit tests of the in-process transport, and of spatial negotiation
+// and subconnectors running on top of it.  Processes of applications
+// are simulated by threads in a single process.  MPI is initialized
+// only because datatype sizes are queried; the program is run
+// directly (not through mpirun) by "make check".
+
+// Leave as first include---required by BG/L
+#include <mpi.h>
+
+#include <iostream>
+#include <vector>
+
+extern "C" {
+#include <pthread.h>
+}
+
+#include "music/transport.hh"
+#include "music/spatial.hh"
+#include "music/subconnector.hh"
+#include "music/permutation_index.hh"
+
+using namespace MUSIC;
+
+static int nFailures = 0;
+
+#define CHECK(expr)							\
+  do									\
+    {									\
+      if (!(expr))							\
+	{								\
+	  std::cerr << __FILE__ << ":" << __LINE__			\
+		    << ": check failed: " #expr << std::endl;		\
+	  ++nFailures;							\
+	}								\
+    }									\
+  while (0)
+
+
+// Runs f (i) for i in [0, n) in n threads
+template<class F>
+static void
+runThreads (int n, F& f)
+{
+  struct Job {
+    F* f;
+    int i;
+    static void* run (void* job)
+    {
+      Job* j = static_cast<Job*> (job);
+      (*j->f) (j->i);
+      return NULL;
+    }
+  };
+  std::vector<Job> jobs (n);
+  std::vector<pthread_t> threads (n);
+  for (int i = 0; i < n; ++i)
+    {
+      jobs[i].f = &f;
+      jobs[i].i = i;
+      pthread_create (&threads[i], NULL, Job::run, &jobs[i]);
+    }
+  for (int i = 0; i < n; ++i)
+    pthread_join (threads[i], NULL);
+}
+
+
+// Messages are matched on source and tag and arrive in order
+static void
+testMatching ()
+{
+  LocalNetwork network;
+  int a = network.addGroup (2);
+  int b = network.addGroup (1);
+  LocalTransport a0 (&network, a, 0, b);
+  LocalTransport a1 (&network, a, 1, b);
+  LocalTransport b0 (&network, b, 0, a);
+  CHECK (b0.remoteSize () == 2);
+  CHECK (a1.remoteSize () == 1);
+
+  int x = 1, y = 2, z = 3;
+  a0.send (&x, 1, MPI::INT, 0, 7);
+  a0.send (&y, 1, MPI::INT, 0, 7);
+  a1.send (&z, 1, MPI::INT, 0, 8);
+  CHECK (!b0.probe (0, 8));
+  CHECK (!b0.probe (1, 7));
+  CHECK (b0.probe (1, 8));
+
+  int r;
+  CHECK (b0.receive (&r, 1, MPI::INT, 1, 8) == sizeof (int));
+  CHECK (r == 3);
+  b0.receive (&r, 1, MPI::INT, 0, 7);
+  CHECK (r == 1);
+  b0.receive (&r, 1, MPI::INT, 0, 7);
+  CHECK (r == 2);
+  CHECK (!b0.probe (0, 7));
+
+  // Empty messages are used for flushing
+  b0.send (&r, 0, MPI::BYTE, 1, 9);
+  CHECK (a1.probe (0, 9));
+  CHECK (a1.receive (&r, 0, MPI::BYTE, 0, 9) == 0);
+}
+
+
+struct Collectives {
+  LocalNetwork* network;
+  int group;
+  std::vector<int> results;
+  void operator() (int rank)
+  {
+    LocalTransport t (network, group, rank, group);
+    int local[2] = { rank, 10 - rank };
+    int global[2];
+    t.allreduceMax (local, global, 2);
+    int value = rank == 2 ? 42 : 0;
+    t.broadcast (&value, 1, MPI::INT, 2);
+    results[rank] = global[0] * 10000 + global[1] * 100 + value;
+  }
+};
+
+
+static void
+testCollectives ()
+{
+  LocalNetwork network;
+  Collectives c;
+  c.network = &network;
+  c.group = network.addGroup (4);
+  c.results.resize (4);
+  runThreads (4, c);
+  for (int r = 0; r < 4; ++r)
+    CHECK (c.results[r] == 3 * 10000 + 10 * 100 + 42);
+}
+
+
+// Spatial negotiation between a sender with a block distribution
+// and a receiver where index i belongs to rank (i / 7) % nIn
+
+const int WIDTH = 100;
+
+static std::vector<IndexInterval>
+senderIntervals (int rank, int nOut)
+{
+  std::vector<IndexInterval> intervals;
+  int begin = rank * WIDTH / nOut;
+  int end = (rank + 1) * WIDTH / nOut;
+  if (end > begin)
+    intervals.push_back (IndexInterval (begin, end, 0));
+  return intervals;
+}
+
+
+static std::vector<IndexInterval>
+receiverIntervals (int rank, int nIn)
+{
+  std::vector<IndexInterval> intervals;
+  for (int b = 7 * rank; b < WIDTH; b += 7 * nIn)
+    intervals.push_back (IndexInterval (b, std::min (b + 7, WIDTH), 0));
+  return intervals;
+}
+
+
+// Routed intervals may span adjacent intervals of an index set
+static bool
+contains (std::vector<IndexInterval>& intervals, int begin, int end)
+{
+  for (int index = begin; index < end; ++index)
+    {
+      unsigned int i = 0;
+      while (i < intervals.size ()
+	     && !(intervals[i].begin () <= index && index < intervals[i].end ()))
+	++i;
+      if (i == intervals.size ())
+	return false;
+    }
+  return true;
+}
+
+
+struct Negotiation {
+  LocalNetwork network;
+  int nOut, nIn;
+  int outGroup, inGroup;
+  // Routing of each endpoint: senders first
+  std::vector<NegotiationIntervals> routing;
+
+  Negotiation (int nOut_, int nIn_)
+    : nOut (nOut_), nIn (nIn_), routing (nOut_ + nIn_)
+  {
+    outGroup = network.addGroup (nOut);
+    inGroup = network.addGroup (nIn);
+  }
+
+  void operator() (int i)
+  {
+    bool output = i < nOut;
+    int rank = output ? i : i - nOut;
+    int group = output ? outGroup : inGroup;
+    int remoteGroup = output ? inGroup : outGroup;
+    LocalTransport comm (&network, group, rank, group);
+    LocalTransport intercomm (&network, group, rank, remoteGroup);
+    std::vector<IndexInterval> intervals
+      = output ? senderIntervals (rank, nOut) : receiverIntervals (rank, nIn);
+    PermutationIndex indices (intervals);
+    SpatialNegotiator* negotiator;
+    if (output)
+      negotiator = new SpatialOutputNegotiator (&indices, Index::GLOBAL);
+    else
+      negotiator = new SpatialInputNegotiator (&indices, Index::GLOBAL);
+    for (NegotiationIterator r = negotiator->negotiate (&comm,
+							&intercomm,
+							output ? nIn : nOut,
+							0,
+							NULL);
+	 !r.end ();
+	 ++r)
+      routing[i].push_back (SpatialNegotiationData (r->interval (),
+						    r->rank ()));
+    delete negotiator;
+  }
+};
+
+
+static void
+testSpatialNegotiation (int nOut, int nIn)
+{
+  Negotiation n (nOut, nIn);
+  runThreads (nOut + nIn, n);
+  for (int i = 0; i < nOut + nIn; ++i)
+    {
+      bool output = i < nOut;
+      int rank = output ? i : i - nOut;
+      std::vector<IndexInterval> own
+	= output ? senderIntervals (rank, nOut) : receiverIntervals (rank, nIn);
+      int ownWidth = 0;
+      for (unsigned int j = 0; j < own.size (); ++j)
+	ownWidth += own[j].end () - own[j].begin ();
+      // Every local index is routed once, to the remote process
+      // which has it
+      int routed = 0;
+      for (unsigned int j = 0; j < n.routing[i].size (); ++j)
+	{
+	  SpatialNegotiationData& d = n.routing[i][j];
+	  routed += d.end () - d.begin ();
+	  CHECK (contains (own, d.begin (), d.end ()));
+	  std::vector<IndexInterval> remote
+	    = (output
+	       ? receiverIntervals (d.rank (), nIn)
+	       : senderIntervals (d.rank (), nOut));
+	  CHECK (contains (remote, d.begin (), d.end ()));
+	}
+      CHECK (routed == ownWidth);
+    }
+}
+
+
+// Cont data, split into several messages, and the flush handshake
+// between a pair of subconnectors, driven from a single thread since
+// sends never block
+static void
+testContSubconnectors ()
+{
+  LocalNetwork network;
+  int out = network.addGroup (1);
+  int in = network.addGroup (1);
+  LocalTransport outTransport (&network, out, 0, in);
+  LocalTransport inTransport (&network, in, 0, out);
+  ContOutputSubconnector sender (NULL, &outTransport, 0, 0, 5, MPI::DOUBLE);
+  ContInputSubconnector receiver (NULL, &inTransport, 0, 0, 0, 5, MPI::DOUBLE);
+
+  const int n = CONT_BUFFER_MAX / sizeof (double) + 10;
+  sender.buffer ()->configure (sizeof (double));
+  for (int i = 0; i < n; ++i)
+    *static_cast<double*> (sender.buffer ()->insert ()) = i;
+  sender.send ();
+  CHECK (sender.statistics ().messages == 2);
+
+  receiver.buffer ()->configure (n * sizeof (double), n * sizeof (double));
+  receiver.receive ();
+  CHECK (receiver.statistics ().bytes == n * sizeof (double));
+  double* data = static_cast<double*> (receiver.buffer ()->next ());
+  bool same = true;
+  for (int i = 0; i < n; ++i)
+    same = same && data[i] == i;
+  CHECK (same);
+
+  bool dataStillFlowing = false;
+  sender.flush (dataStillFlowing);
+  CHECK (!dataStillFlowing);
+  receiver.flush (dataStillFlowing);
+  CHECK (!dataStillFlowing);
+}
+
+
+int
+main (int argc, char* argv[])
+{
+  MPI::Init (argc, argv);
+  testMatching ();
+  testCollectives ();
+  testSpatialNegotiation (1, 1);
+  testSpatialNegotiation (2, 3);
+  testSpatialNegotiation (3, 2);
+  testSpatialNegotiation (4, 1);
+  testContSubconnectors ();
+  MPI::Finalize ();
+  if (nFailures > 0)
+    {
+      std::cerr << nFailures << " checks failed" << std::endl;
+      return 1;
+    }
+  return 0;
+}
@@ -29,12 +29,14 @@ namespace MUSIC {
 
   // NOTE: Could check here that obligatory parameters exists
   ApplicationMapper::ApplicationMapper (std::istream* configFile, int rank)
+    : connectivityMap_ (0)
   {
     cfile = new rude::Config ();
     cfile->load (*configFile);
 
     mapSections (cfile);
     mapApplications ();
+    mapConnections ();
     selectApplication (rank);
     mapConnectivity (selectedName);
   }
@@ -107,12 +109,14 @@ namespace MUSIC {
   }
 
 
+  // Collect the connections of the configuration file once, so
+  // that mapping the connectivity of an application only visits its
+  // own connections
   void
-  ApplicationMapper::mapConnectivity (std::string thisName)
+  ApplicationMapper::mapConnections ()
   {
-    std::map<std::string, int> receiverPortCodes;
-    int nextPortCode = 0;
-    connectivityMap_ = new Connectivity ();
+    NameTable receiverPorts;
+    appConnections_.resize (applications_->size ());
     int nSections = cfile->getNumSections ();
     for (int s = 0; s < nSections; ++s)
       {
@@ -145,6 +149,19 @@ namespace MUSIC {
 	    if (senderApp == receiverApp)
 	      error ("port " + senderPort + " of application " + senderApp + " connected to the same application");
 
+	    ApplicationInfo* sender = applications_->lookup (senderApp);
+	    if (sender == 0)
+	      error ("unknown sender application " + senderApp);
+	    ApplicationInfo* receiver = applications_->lookup (receiverApp);
+	    if (receiver == 0)
+	      error ("unknown receiver application " + receiverApp);
+
+	    ConnectionSpec spec;
+	    spec.senderApp = sender - &(*applications_)[0];
+	    spec.receiverApp = receiver - &(*applications_)[0];
+	    spec.senderPort = senderPort;
+	    spec.receiverPort = receiverPort;
+
 	    // Generate a unique "port code" for each receiver port
 	    // name.  This will later be used during temporal
 	    // negotiation since it easier to communicate integers,
@@ -152,58 +169,68 @@ namespace MUSIC {
 	    //
 	    // NOTE: This code must be executed in the same order in
 	    // all MPI processes.
-	    std::string receiverPortFullName = receiverApp + "." + receiverPort;
-	    std::map<std::string, int>::iterator pos
-	      = receiverPortCodes.find (receiverPortFullName);
-	    int portCode;
-	    if (pos == receiverPortCodes.end ())
-	      {
-		portCode = nextPortCode++;
-		receiverPortCodes.insert (std::make_pair (receiverPortFullName,
-							  portCode));
-	      }
-	    else
-	      portCode = pos->second;
+	    spec.receiverPortCode
+	      = receiverPorts.intern (receiverApp + "." + receiverPort);
 
-	    ConnectivityInfo::PortDirection dir;
-	    ApplicationInfo* remoteInfo;
-	    if (thisName == senderApp)
-	      {
-		dir = ConnectivityInfo::OUTPUT;
-		remoteInfo = applications_->lookup (receiverApp);
-	      }
-	    else if (thisName == receiverApp)
-	      {
-		dir = ConnectivityInfo::INPUT;
-		remoteInfo = applications_->lookup (senderApp);
-	      }
-	    else
-	      continue;
-	    int w;
 	    if (width == "")
-	      w = ConnectivityInfo::NO_WIDTH;
+	      spec.width = ConnectivityInfo::NO_WIDTH;
 	    else
 	      {
 		std::istringstream ws (width);
-		if (!(ws >> w))
+		if (!(ws >> spec.width))
 		  error ("could not interpret width");
 	      }
 
-	    connectivityMap_->add (dir == ConnectivityInfo::OUTPUT
-				   ? senderPort
-				   : receiverPort,
-				   dir,
-				   w,
-				   receiverApp,
-				   receiverPort,
-				   portCode,
-				   remoteInfo->leader (),
-				   remoteInfo->nProc ());
+	    int index = connections_.size ();
+	    connections_.push_back (spec);
+	    appConnections_[spec.senderApp].push_back (index);
+	    appConnections_[spec.receiverApp].push_back (index);
 	  }
       }
   }
 
 
+  // The mapper owns the connectivity map and replaces it on each
+  // call.  The configurations only borrow it through config ().
+  void
+  ApplicationMapper::mapConnectivity (std::string thisName)
+  {
+    delete connectivityMap_;
+    connectivityMap_ = new Connectivity ();
+    ApplicationInfo* thisInfo = applications_->lookup (thisName);
+    if (thisInfo == 0)
+      return;
+    int thisApp = thisInfo - &(*applications_)[0];
+    std::vector<int>& conns = appConnections_[thisApp];
+    for (std::vector<int>::iterator c = conns.begin (); c != conns.end (); ++c)
+      {
+	ConnectionSpec& spec = connections_[*c];
+	ConnectivityInfo::PortDirection dir;
+	ApplicationInfo* remoteInfo;
+	if (spec.senderApp == thisApp)
+	  {
+	    dir = ConnectivityInfo::OUTPUT;
+	    remoteInfo = &(*applications_)[spec.receiverApp];
+	  }
+	else
+	  {
+	    dir = ConnectivityInfo::INPUT;
+	    remoteInfo = &(*applications_)[spec.senderApp];
+	  }
+	connectivityMap_->add (dir == ConnectivityInfo::OUTPUT
+			       ? spec.senderPort
+			       : spec.receiverPort,
+			       dir,
+			       spec.width,
+			       (*applications_)[spec.receiverApp].name (),
+			       spec.receiverPort,
+			       spec.receiverPortCode,
+			       remoteInfo->leader (),
+			       remoteInfo->nProc ());
+      }
+  }
+
+
   MUSIC::Configuration*
   ApplicationMapper::config ()
   {
@@ -220,4 +247,13 @@ namespace MUSIC {
     return config;
   }
 
+
+  void
+  ApplicationMapper::insert (std::string name, std::string value)
+  {
+    std::map<std::string, MUSIC::Configuration*>::iterator c;
+    for (c = configs.begin (); c != configs.end (); ++c)
+      c->second->insert (name, value);
+  }
+
 }
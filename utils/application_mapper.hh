@@ -20,27 +20,45 @@
 
 #include <istream>
 #include <map>
+#include <vector>
 
 #include "rudeconfig/src/config.h"
 
 #include <music/configuration.hh>
+#include <music/name_table.hh>
 
 namespace MUSIC {
 
   class ApplicationMapper {
+    // A connection of the configuration file
+    class ConnectionSpec {
+    public:
+      int senderApp;		// index in applications_
+      std::string senderPort;
+      int receiverApp;		// index in applications_
+      std::string receiverPort;
+      int width;
+      int receiverPortCode;
+    };
     rude::Config* cfile;
     std::map<std::string, MUSIC::Configuration*> configs;
     ApplicationMap* applications_;
     Connectivity* connectivityMap_;
     std::string selectedName;
+    std::vector<ConnectionSpec> connections_;
+    // Connections of each application, in order of appearance
+    std::vector<std::vector<int> > appConnections_;
     void mapSections (rude::Config* cfile);
     void mapApplications ();
+    void mapConnections ();
     void selectApplication (int rank);
   public:
     ApplicationMapper (std::istream* configFile, int rank);
     void mapConnectivity (std::string name);
     MUSIC::Configuration* config ();
     MUSIC::Configuration* config (std::string name);
+    // Set a configuration variable of every application
+    void insert (std::string name, std::string value);
   };
 
 }
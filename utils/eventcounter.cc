@@ -202,14 +202,9 @@ main (int argc, char *argv[])
 
   MUSIC::Runtime* runtime = new MUSIC::Runtime (setup, timestep);
 
-  double time = runtime->time ();
-  while (time < stoptime)
-    {
-      // Retrieve data from other program
-      runtime->tick ();
-      
-      time = runtime->time ();
-    }
+  // Retrieve data from other program
+  runtime->tickUntil (stoptime);
+
   for (std::vector<int>::iterator i = counters.begin ();
        i != counters.end ();
        ++i)
@@ -18,6 +18,8 @@
 
 #include <string>
 #include <fstream>
+#include <sstream>
+#include <vector>
 
 #include "config.h"
 
@@ -28,6 +30,8 @@
 
 extern "C" {
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <getopt.h>
 #include <stdlib.h>
@@ -46,6 +50,9 @@ usage (int rank)
 		<< "  -h, --help            print this help message" << std::endl
 		<< "  -m, --map             print application rank map" << std::endl
 		<< "  -e, --export-scripts  export launcher scripts" << std::endl
+		<< "  -n, --node-parse      parse CONFIG once per node" << std::endl
+		<< "  -s, --statistics=FILE append communication statistics to FILE" << std::endl
+		<< "                        (or write them to stderr if FILE is `stderr')" << std::endl
 		<< "  -v, --version         prints version of MUSIC library" << std::endl
 		<< std::endl
 		<< "Report bugs to <music-bugs@incf.org>." << std::endl;
@@ -115,12 +122,52 @@ print_version (int rank)
 }
 
 
+// Name part of the configuration images which keeps concurrent jobs
+// on a node apart, since each job removes its images at startup.
+// The processes of one launch on a node share the parent process.
+string
+image_tag ()
+{
+  std::ostringstream tag;
+  string jobId = getJobId ();
+  if (jobId != "")
+    tag << jobId << '-';
+  tag << getppid ();
+  return tag.str ();
+}
+
+
+// Pass the configuration to the application as a node-local
+// configuration image.  Returns false if the image couldn't be
+// written.
+bool
+write_image (MUSIC::Configuration* config)
+{
+  string directory;
+  if (!config->lookup ("config_image_dir", &directory))
+    {
+      char* tmpdir = getenv ("TMPDIR");
+      directory = tmpdir != NULL ? tmpdir : "/tmp";
+    }
+  return config->writeImageEnv (directory, image_tag ());
+}
+
+
+// Pass the configuration to the application as a node-local
+// configuration image if possible and otherwise in the environment
 void
-launch (MUSIC::Configuration* config, char** argv)
+write_config (MUSIC::Configuration* config)
+{
+  if (!write_image (config))
+    config->writeEnv ();
+}
+
+
+void
+exec_binary (MUSIC::Configuration* config, char** argv)
 {
   string binary;
   config->lookup ("binary", &binary);
-  config->writeEnv ();
   string wd;
   if (config->lookup ("wd", &wd))
     {
@@ -137,6 +184,259 @@ launch (MUSIC::Configuration* config, char** argv)
 }
 
 
+void
+launch (MUSIC::Configuration* config, char** argv)
+{
+  write_config (config);
+  exec_binary (config, argv);
+}
+
+
+/*
+ * With --node-parse, the first process on each node parses the
+ * configuration file, writes the configuration images of all
+ * applications and lists them in a launch index in a node-local
+ * directory.  The other processes on the node wait for the index
+ * and launch from the image of their application without touching
+ * the configuration file.
+ *
+ * The index starts with an identity line naming the configuration
+ * file (path, inode, size and modification time) and the launch (the
+ * process id and start time of the parent, which is shared by all
+ * processes of the launch on the node).  An index with another
+ * identity is left over from an earlier job and is ignored.
+ *
+ * Each process of the node, the leader included, appends the number
+ * of the index entry of its application to the acknowledgement file
+ * <index>.done.  The process which completes the count removes both
+ * files and the images of the applications without processes on the
+ * node.  The other images are removed by the applications when they
+ * have read them (see Configuration::removeImage).  Processes which
+ * give up waiting never acknowledge, so the files remain if the
+ * leader is slow beyond launchIndexWait.
+ */
+
+// Time, in units of launchIndexPoll, which a process waits for the
+// launch index before parsing the configuration file itself
+const static int launchIndexWait = 6000;
+const static useconds_t launchIndexPoll = 10000;
+
+string
+launch_index_path (string jobId)
+{
+  char* tmpdir = getenv ("TMPDIR");
+  string directory = tmpdir != NULL ? tmpdir : "/tmp";
+  return directory + "/music-launch-" + jobId + ".idx";
+}
+
+
+string
+launch_index_done_path (string path)
+{
+  return path + ".done";
+}
+
+
+// Start time of process pid in clock ticks since boot, or 0 if
+// unknown
+unsigned long long
+process_start_time (pid_t pid)
+{
+  std::ostringstream statPath;
+  statPath << "/proc/" << pid << "/stat";
+  std::ifstream stat (statPath.str ().c_str ());
+  string line;
+  if (!std::getline (stat, line))
+    return 0;
+  // Fields following the command name, which is in parentheses and
+  // may contain blanks; the start time is field 22
+  string::size_type end = line.rfind (')');
+  if (end == string::npos)
+    return 0;
+  std::istringstream fields (line.substr (end + 1));
+  string field;
+  for (int i = 3; i < 22; ++i)
+    fields >> field;
+  unsigned long long startTime;
+  if (!(fields >> startTime))
+    return 0;
+  return startTime;
+}
+
+
+// Identity of the configuration file and of this launch.  Returns ""
+// if the configuration file can't be examined.
+string
+launch_identity (string configPath)
+{
+  struct stat st;
+  if (stat (configPath.c_str (), &st) != 0)
+    return "";
+  pid_t parent = getppid ();
+  std::ostringstream identity;
+  identity << "config " << configPath
+	   << ' ' << st.st_dev << ':' << st.st_ino
+	   << ' ' << st.st_size << ' ' << st.st_mtime
+	   << " launch " << parent << ' ' << process_start_time (parent);
+  return identity.str ();
+}
+
+
+// Each line after the identity holds leader, number of processes and
+// image reference of one application.  An index without such lines
+// tells the other processes to parse the configuration file
+// themselves.
+void
+write_launch_index (MUSIC::ApplicationMapper* map,
+		    string path,
+		    string identity,
+		    int rank)
+{
+  std::ostringstream index;
+  string selected;
+  int entry = -1;
+  int nEntries = 0;
+  MUSIC::ApplicationMap* a = map->config ()->applications ();
+  for (MUSIC::ApplicationMap::iterator i = a->begin (); i != a->end (); ++i)
+    {
+      if (rank >= i->leader () && rank < i->leader () + i->nProc ())
+	{
+	  selected = i->name ();
+	  entry = nEntries;
+	}
+      map->mapConnectivity (i->name ());
+      if (!write_image (map->config (i->name ())))
+	{
+	  index.str ("");
+	  break;
+	}
+      index << i->leader () << ' ' << i->nProc () << ' '
+	    << getenv (configEnvVarName) << std::endl;
+      ++nEntries;
+    }
+  // Restore the connectivity of our own application
+  map->mapConnectivity (selected);
+
+  // Reset the acknowledgements, with our own, before the index
+  // becomes visible
+  string done = launch_index_done_path (path);
+  int fd = open (done.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (fd == -1)
+    return;
+  bool acknowledged = write (fd, &entry, sizeof (entry)) == sizeof (entry);
+  close (fd);
+
+  // Write to a private file first so that other processes never see
+  // a partial index
+  std::ostringstream tmpPath;
+  tmpPath << path << '.' << getpid ();
+  std::ofstream file (tmpPath.str ().c_str ());
+  file << identity << std::endl << index.str ();
+  file.close ();
+  if (!acknowledged
+      || !file
+      || rename (tmpPath.str ().c_str (), path.c_str ()) != 0)
+    {
+      std::remove (tmpPath.str ().c_str ());
+      std::remove (done.c_str ());
+    }
+}
+
+
+// Count this process, which launches the application of entry, as a
+// reader of the index.  If all processes on the node have read it,
+// remove the index and the images which no process on the node uses.
+void
+acknowledge_launch_index (string path,
+			  int localSize,
+			  int entry,
+			  const std::vector<string>& images)
+{
+  string done = launch_index_done_path (path);
+  int fd = open (done.c_str (), O_RDWR | O_APPEND);
+  if (fd == -1)
+    return;
+  struct stat st;
+  if (write (fd, &entry, sizeof (entry)) == sizeof (entry)
+      && fstat (fd, &st) == 0
+      && st.st_size >= static_cast<off_t> (localSize * sizeof (int)))
+    {
+      std::vector<bool> used (images.size (), false);
+      std::vector<int> entries (localSize);
+      if (pread (fd, &entries[0], localSize * sizeof (int), 0)
+	  == static_cast<ssize_t> (localSize * sizeof (int)))
+	{
+	  for (int i = 0; i < localSize; ++i)
+	    if (entries[i] >= 0
+		&& entries[i] < static_cast<int> (images.size ()))
+	      used[entries[i]] = true;
+	  for (unsigned int i = 0; i < images.size (); ++i)
+	    if (!used[i])
+	      {
+		// An image reference is IMAGE:HASH:PATH
+		string::size_type colon = images[i].find (':', 6);
+		if (colon != string::npos)
+		  unlink (images[i].substr (colon + 1).c_str ());
+	      }
+	}
+      unlink (path.c_str ());
+      unlink (done.c_str ());
+    }
+  close (fd);
+}
+
+
+// Look up the image reference of the application of rank in the
+// launch index with the given identity.  Returns false if there is
+// no usable index.
+bool
+read_launch_index (string path,
+		   string identity,
+		   int localSize,
+		   int rank,
+		   string* image)
+{
+  for (int i = 0; i < launchIndexWait; ++i)
+    {
+      std::ifstream index (path.c_str ());
+      string indexIdentity;
+      if (!std::getline (index, indexIdentity) || indexIdentity != identity)
+	{
+	  usleep (launchIndexPoll);
+	  continue;
+	}
+      std::vector<string> images;
+      int entry = -1;
+      int leader, nProc;
+      string reference;
+      while (index >> leader >> nProc)
+	{
+	  index.ignore ();
+	  std::getline (index, reference);
+	  if (rank >= leader && rank < leader + nProc)
+	    {
+	      entry = images.size ();
+	      *image = reference;
+	    }
+	  images.push_back (reference);
+	}
+      index.close ();
+      acknowledge_launch_index (path, localSize, entry, images);
+      return entry != -1;
+    }
+  return false;
+}
+
+
+void
+launch_image (string image, char** argv)
+{
+  setenv (configEnvVarName, image.c_str (), 1);
+  MUSIC::Configuration config;
+  exec_binary (&config, argv);
+}
+
+
 int
 main (int argc, char *argv[])
 {
@@ -146,7 +446,9 @@ main (int argc, char *argv[])
 
   bool do_print_map = false;
   bool do_export_scripts = false;
-  
+  bool do_node_parse = false;
+  string statistics;
+
   opterr = 0; // handle errors ourselves
   while (1)
     {
@@ -155,6 +457,8 @@ main (int argc, char *argv[])
 	  {"help",           no_argument,       0, 'h'},
 	  {"map",            required_argument, 0, 'm'},
 	  {"export-scripts", no_argument,       0, 'e'},
+	  {"node-parse",     no_argument,       0, 'n'},
+	  {"statistics",     required_argument, 0, 's'},
 	  {"version",        no_argument,       0, 'v'},
 	  {0, 0, 0, 0}
 	};
@@ -162,7 +466,7 @@ main (int argc, char *argv[])
       int option_index = 0;
 
       // the + below tells getopt_long not to reorder argv
-      int c = getopt_long (argc, argv, "+hm:ev", longOptions, &option_index);
+      int c = getopt_long (argc, argv, "+hm:ens:v", longOptions, &option_index);
 
       /* detect the end of the options */
       if (c == -1)
@@ -180,6 +484,12 @@ main (int argc, char *argv[])
 	case 'e':
 	  do_export_scripts = true;
 	  continue;
+	case 'n':
+	  do_node_parse = true;
+	  continue;
+	case 's':
+	  statistics = optarg;
+	  continue;
 	case 'v':
 	  print_version (rank);
 
@@ -188,20 +498,51 @@ main (int argc, char *argv[])
 	}
     }
 
+  // The node leader, and processes for which no leader could be
+  // elected, fall through to parse the configuration file
+  string launchIndex;
+  string launchIdentity;
+  if (do_node_parse && !do_print_map && !do_export_scripts && rank != -1
+      && optind < argc)
+    {
+      int localRank = getLocalRank ();
+      int localSize = getLocalSize ();
+      string jobId = getJobId ();
+      if (localRank != -1 && localSize > 1 && jobId != "")
+	launchIdentity = launch_identity (argv[optind]);
+      if (launchIdentity != "")
+	{
+	  launchIndex = launch_index_path (jobId);
+	  string image;
+	  if (localRank > 0
+	      && read_launch_index (launchIndex, launchIdentity,
+				    localSize, rank, &image))
+	    launch_image (image, argv);
+	  if (localRank > 0)
+	    launchIndex = "";
+	}
+    }
+
   // extract the configuration file name using
-  // mpi implementation dependent code from ../mpidep
-  std::istream* configFile = getConfig (rank, argc, argv);
+  // mpi implementation dependent code from ../mpidep; pass only the
+  // arguments after the options so that option values are skipped
+  std::istream* configFile = getConfig (rank,
+					argc - optind + 1,
+					argv + optind - 1);
 
   if (!*configFile)
     {
       if (rank <= 0)
 	std::cerr << "MUSIC: Couldn't open configuration file "
-		  << argv[1] << std::endl;
+		  << (optind < argc ? argv[optind] : "") << std::endl;
       exit (1);
     }
 
   MUSIC::ApplicationMapper map (configFile, rank);
 
+  if (statistics != "")
+    map.insert ("statistics", statistics);
+
   if (do_print_map)
     {
       if (rank <= 0)
@@ -225,6 +566,9 @@ main (int argc, char *argv[])
       exit (1);
     }
 
+  if (launchIndex != "")
+    write_launch_index (&map, launchIndex, launchIdentity, rank);
+
   launch (map.config (), argv);
 
   return 0;